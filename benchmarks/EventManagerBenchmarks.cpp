@@ -0,0 +1,436 @@
+//
+//  EventManagerBenchmarks.cpp
+//  Cinder-EventManager
+//
+//
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "EventManager.h"
+#include "FastDelegate.h"
+
+namespace {
+
+// A minimal event. Benchmarks only care about dispatch, so it carries nothing.
+class BenchEvent : public EventData {
+public:
+	static EventType TYPE;
+	enum FilterField : uint32_t { FIELD_KEY = 1 };
+	
+	//! Only events built with an \a eventKey are routed to keyed listeners;
+	//! the rest skip the keyed table lookup like any unkeyed event.
+	explicit BenchEvent( double key = 0.0, EventKey eventKey = NO_EVENT_KEY ) : mKey( key ), mEventKey( eventKey ) {}
+	
+	double getFilterValue( uint32_t field ) const override { return field == FIELD_KEY ? mKey : EventData::getFilterValue( field ); }
+	EventKey getEventKey() const override { return mEventKey; }
+	EventDataRef copy() override { return std::make_shared<BenchEvent>( *this ); }
+	const char* getName() const override { return "BenchEvent"; }
+	EventType getEventType() const override { return TYPE; }
+	void serialize( EventBuffer &/*streamOut*/ ) override {}
+	void deSerialize( const EventBuffer &/*streamIn*/ ) override {}
+	
+	double mKey;
+	EventKey mEventKey;
+};
+
+EventType BenchEvent::TYPE = 0xbe9c4a11u;
+
+// A click at a position, like the MouseEvent sample's MousePositionEvent.
+class PositionEvent : public EventData {
+public:
+	static EventType TYPE;
+	enum FilterField : uint32_t { FIELD_X = 1, FIELD_Y };
+	
+	PositionEvent( double x, double y ) : mX( x ), mY( y ) {}
+	
+	double getFilterValue( uint32_t field ) const override
+	{
+		return field == FIELD_X ? mX : field == FIELD_Y ? mY : EventData::getFilterValue( field );
+	}
+	EventDataRef copy() override { return std::make_shared<PositionEvent>( mX, mY ); }
+	const char* getName() const override { return "PositionEvent"; }
+	EventType getEventType() const override { return TYPE; }
+	void serialize( EventBuffer &/*streamOut*/ ) override {}
+	void deSerialize( const EventBuffer &/*streamIn*/ ) override {}
+	
+	double mX, mY;
+};
+
+EventType PositionEvent::TYPE = 0x9051710u;
+
+// Listeners are distinct objects so every delegate is distinct.
+struct Listener {
+	void onEvent( EventDataRef /*event*/ ) { benchmark::DoNotOptimize( ++mCount ); }
+	uint64_t mCount = 0;
+};
+
+EventListenerDelegate makeDelegate( Listener &listener )
+{
+	return EventListenerDelegate::create<Listener, &Listener::onEvent>( &listener );
+}
+
+void BM_AddRemoveListener( benchmark::State &state )
+{
+	auto manager = EventManager::create( "Bench", false );
+	std::vector<Listener> listeners( state.range( 0 ) );
+	for( auto _ : state ) {
+		for( auto &listener : listeners )
+			manager->addListener( makeDelegate( listener ), BenchEvent::TYPE );
+		for( auto &listener : listeners )
+			manager->removeListener( makeDelegate( listener ), BenchEvent::TYPE );
+	}
+	state.SetItemsProcessed( state.iterations() * state.range( 0 ) * 2 );
+}
+BENCHMARK( BM_AddRemoveListener )->RangeMultiplier( 10 )->Range( 1, 10000 );
+
+void BM_AddRemoveCallableListener( benchmark::State &state )
+{
+	auto manager = EventManager::create( "Bench", false );
+	std::vector<Listener> listeners( state.range( 0 ) );
+	std::vector<EventListenerHandle> handles( listeners.size() );
+	for( auto _ : state ) {
+		for( size_t i = 0; i < listeners.size(); ++i ) {
+			auto listener = &listeners[i];
+			handles[i] = manager->addListener( [listener]( EventDataRef event ) { listener->onEvent( event ); }, BenchEvent::TYPE );
+		}
+		for( auto &handle : handles )
+			manager->removeListener( handle );
+	}
+	state.SetItemsProcessed( state.iterations() * state.range( 0 ) * 2 );
+}
+BENCHMARK( BM_AddRemoveCallableListener )->RangeMultiplier( 10 )->Range( 1, 10000 );
+
+// Listeners that only want one event. Arg 0 has each one remove itself by
+// handle from inside its call; arg 1 registers them with addListenerOnce().
+void BM_OneShotListeners( benchmark::State &state )
+{
+	auto manager = EventManager::create( "Bench", false );
+	std::vector<Listener> listeners( state.range( 0 ) );
+	std::vector<EventListenerHandle> handles( listeners.size() );
+	EventDataRef event = std::make_shared<BenchEvent>();
+	for( auto _ : state ) {
+		for( size_t i = 0; i < listeners.size(); ++i ) {
+			auto listener = &listeners[i];
+			if( state.range( 1 ) )
+				manager->addListenerOnce( [listener]( EventDataRef event ) { listener->onEvent( event ); }, BenchEvent::TYPE );
+			else {
+				auto handle = &handles[i];
+				auto owner = manager.get();
+				*handle = manager->addListener( [listener, handle, owner]( EventDataRef event ) {
+					listener->onEvent( event );
+					owner->removeListener( *handle );
+				}, BenchEvent::TYPE );
+			}
+		}
+		manager->triggerEvent( event );
+	}
+	state.SetItemsProcessed( state.iterations() * state.range( 0 ) );
+}
+BENCHMARK( BM_OneShotListeners )->ArgsProduct( { { 10, 1000 }, { 0, 1 } } );
+
+void BM_TriggerEvent( benchmark::State &state )
+{
+	auto manager = EventManager::create( "Bench", false );
+	std::vector<Listener> listeners( state.range( 0 ) );
+	for( auto &listener : listeners )
+		manager->addListener( makeDelegate( listener ), BenchEvent::TYPE );
+	EventDataRef event = std::make_shared<BenchEvent>();
+	for( auto _ : state )
+		manager->triggerEvent( event );
+	state.SetItemsProcessed( state.iterations() * state.range( 0 ) );
+}
+BENCHMARK( BM_TriggerEvent )->RangeMultiplier( 10 )->Range( 1, 10000 );
+
+// Listener objects are allocated one by one and registered in shuffled order,
+// as they would be after churn. Arg 1 lets update() sort them by address.
+void BM_TriggerEventScatteredTargets( benchmark::State &state )
+{
+	auto manager = EventManager::create( "Bench", false );
+	manager->setSortListenersByTarget( state.range( 1 ) != 0 );
+	std::vector<std::unique_ptr<Listener>> listeners;
+	for( int64_t i = 0; i < state.range( 0 ); ++i )
+		listeners.emplace_back( new Listener );
+	std::shuffle( listeners.begin(), listeners.end(), std::mt19937( 42 ) );
+	for( auto &listener : listeners )
+		manager->addListener( makeDelegate( *listener ), BenchEvent::TYPE );
+	manager->setDefragmentBudget( EventManager::kINFINITE );
+	manager->update();
+	EventDataRef event = std::make_shared<BenchEvent>();
+	for( auto _ : state )
+		manager->triggerEvent( event );
+	state.SetItemsProcessed( state.iterations() * state.range( 0 ) );
+}
+BENCHMARK( BM_TriggerEventScatteredTargets )->ArgsProduct( { { 1000, 100000 }, { 0, 1 } } );
+
+// Every listener wants one key out of range( 0 ) and the event matches one of
+// them. Arg 0 has each listener test the key itself after a cast, arg 1 hands
+// the test to the dispatcher as an EventFilter and arg 2 subscribes each
+// listener to its key.
+void BM_TriggerEventKeyed( benchmark::State &state )
+{
+	auto manager = EventManager::create( "Bench", false );
+	std::vector<Listener> listeners( state.range( 0 ) );
+	for( size_t i = 0; i < listeners.size(); ++i ) {
+		auto listener = &listeners[i];
+		double key = static_cast<double>( i );
+		if( state.range( 1 ) == 2 )
+			manager->addListener( makeDelegate( *listener ), BenchEvent::TYPE, static_cast<EventKey>( i ) );
+		else if( state.range( 1 ) == 1 )
+			manager->addListener( makeDelegate( *listener ), BenchEvent::TYPE, EventFilter::equal( BenchEvent::FIELD_KEY, key ) );
+		else {
+			manager->addListener( [listener, key]( EventDataRef event ) {
+				auto benchEvent = std::dynamic_pointer_cast<BenchEvent>( event );
+				if( benchEvent && benchEvent->mKey == key )
+					listener->onEvent( event );
+			}, BenchEvent::TYPE );
+		}
+	}
+	EventDataRef event = std::make_shared<BenchEvent>( 3.0, state.range( 1 ) == 2 ? EventKey( 3 ) : NO_EVENT_KEY );
+	for( auto _ : state )
+		manager->triggerEvent( event );
+	state.SetItemsProcessed( state.iterations() * state.range( 0 ) );
+}
+BENCHMARK( BM_TriggerEventKeyed )->ArgsProduct( { { 100, 10000 }, { 0, 1, 2 } } );
+
+// range( 0 ) circles of radius 4 to 12 are scattered over a 4096 square and
+// clicks land at random. Arg 0 has each circle test the click itself after a
+// cast, as the MouseEvent sample's Circle does, arg 1 hands its box to the
+// dispatcher as an EventFilter and arg 2 also routes clicks through a grid.
+void BM_TriggerEventSpatial( benchmark::State &state )
+{
+	struct Circle {
+		void onEvent( EventDataRef /*event*/ ) { benchmark::DoNotOptimize( ++mCount ); }
+		double mX, mY, mRadius;
+		uint64_t mCount = 0;
+	};
+	
+	auto manager = EventManager::create( "Bench", false );
+	if( state.range( 1 ) == 2 )
+		manager->setSpatialIndex( PositionEvent::TYPE, PositionEvent::FIELD_X, PositionEvent::FIELD_Y, 32 );
+	std::mt19937 rng( 42 );
+	std::uniform_real_distribution<double> position( 0, 4096 ), radius( 4, 12 );
+	std::vector<Circle> circles( state.range( 0 ) );
+	for( auto &circle : circles ) {
+		circle.mX = position( rng );
+		circle.mY = position( rng );
+		circle.mRadius = radius( rng );
+		auto c = &circle;
+		if( state.range( 1 ) == 0 ) {
+			manager->addListener( [c]( EventDataRef event ) {
+				auto click = std::dynamic_pointer_cast<PositionEvent>( event );
+				if( click && std::abs( click->mX - c->mX ) <= c->mRadius && std::abs( click->mY - c->mY ) <= c->mRadius )
+					c->onEvent( event );
+			}, PositionEvent::TYPE );
+		}
+		else {
+			auto box = EventFilter::range( PositionEvent::FIELD_X, c->mX - c->mRadius, c->mX + c->mRadius )
+				.andRange( PositionEvent::FIELD_Y, c->mY - c->mRadius, c->mY + c->mRadius );
+			manager->addListener( EventListenerDelegate::create<Circle, &Circle::onEvent>( c ), PositionEvent::TYPE, box );
+		}
+	}
+	std::vector<EventDataRef> clicks;
+	for( int i = 0; i < 256; ++i )
+		clicks.push_back( std::make_shared<PositionEvent>( position( rng ), position( rng ) ) );
+	size_t i = 0;
+	for( auto _ : state )
+		manager->triggerEvent( clicks[i++ & 255] );
+	state.SetItemsProcessed( state.iterations() * state.range( 0 ) );
+}
+BENCHMARK( BM_TriggerEventSpatial )->ArgsProduct( { { 1000, 50000 }, { 0, 1, 2 } } );
+
+void BM_QueueAndUpdate( benchmark::State &state )
+{
+	auto manager = EventManager::create( "Bench", false );
+	Listener listener;
+	manager->addListener( makeDelegate( listener ), BenchEvent::TYPE );
+	EventDataRef event = std::make_shared<BenchEvent>();
+	for( auto _ : state ) {
+		for( int64_t i = 0; i < state.range( 0 ); ++i )
+			manager->queueEvent( event );
+		manager->update();
+	}
+	state.SetItemsProcessed( state.iterations() * state.range( 0 ) );
+}
+BENCHMARK( BM_QueueAndUpdate )->RangeMultiplier( 10 )->Range( 1, 10000 );
+
+// An overloaded frame: 10000 events queued against a capacity of 100, for
+// each overflow policy that applies on the owning thread. Arg 0 is the
+// OverflowPolicy; arg 1 bounds the event type rather than the whole queue.
+void BM_QueueEventOverCapacity( benchmark::State &state )
+{
+	auto manager = EventManager::create( "Bench", false );
+	Listener listener;
+	manager->addListener( makeDelegate( listener ), BenchEvent::TYPE );
+	const auto policy = static_cast<EventManager::OverflowPolicy>( state.range( 0 ) );
+	if( state.range( 1 ) )
+		manager->setQueueCapacity( BenchEvent::TYPE, 100, policy );
+	else
+		manager->setQueueCapacity( 100, policy );
+	EventDataRef event = std::make_shared<BenchEvent>();
+	for( auto _ : state ) {
+		for( int i = 0; i < 10000; ++i )
+			manager->queueEvent( event );
+		manager->update();
+	}
+	state.SetItemsProcessed( state.iterations() * 10000 );
+}
+BENCHMARK( BM_QueueEventOverCapacity )->ArgsProduct( { { 0, 1, 2, 3 }, { 0, 1 } } );
+
+// Round trips through request(): a listener answers each query with a queued
+// reply, and the futures are collected after the update that dispatches it.
+void BM_RequestReply( benchmark::State &state )
+{
+	auto manager = EventManager::create( "Bench", false );
+	auto owner = manager.get();
+	manager->addListener( [owner]( EventDataRef query ) {
+		auto reply = std::make_shared<PositionEvent>( 0.0, 0.0 );
+		reply->replyTo( *query );
+		owner->queueEvent( reply );
+	}, BenchEvent::TYPE );
+	std::vector<std::shared_ptr<BenchEvent>> queries( state.range( 0 ) );
+	for( auto &query : queries )
+		query = std::make_shared<BenchEvent>();
+	std::vector<EventFuture<PositionEvent>> futures( queries.size() );
+	for( auto _ : state ) {
+		for( size_t i = 0; i < queries.size(); ++i )
+			futures[i] = manager->request<BenchEvent, PositionEvent>( queries[i], 1.0 );
+		manager->update();
+		manager->update();
+		for( auto &future : futures )
+			benchmark::DoNotOptimize( future.get() );
+	}
+	state.SetItemsProcessed( state.iterations() * state.range( 0 ) );
+}
+BENCHMARK( BM_RequestReply )->RangeMultiplier( 10 )->Range( 1, 1000 );
+
+EventManagerRef			sThreadedManager;
+std::vector<Listener>	sThreadedListeners;
+
+void BM_TriggerThreadedEvent( benchmark::State &state )
+{
+	if( state.thread_index() == 0 ) {
+		sThreadedManager = EventManager::create( "Bench", false );
+		sThreadedListeners.assign( 16, Listener() );
+		for( auto &listener : sThreadedListeners )
+			sThreadedManager->addThreadedListener( makeDelegate( listener ), BenchEvent::TYPE );
+	}
+	EventDataRef event = std::make_shared<BenchEvent>();
+	for( auto _ : state )
+		sThreadedManager->triggerThreadedEvent( event );
+	state.SetItemsProcessed( state.iterations() );
+	if( state.thread_index() == 0 ) {
+		sThreadedManager.reset();
+		sThreadedListeners.clear();
+	}
+}
+BENCHMARK( BM_TriggerThreadedEvent )->ThreadRange( 1, 8 )->UseRealTime();
+
+EventManagerRef			sMailboxManager;
+Listener				sMailboxListener;
+
+// Thread 0 owns the manager and runs update() while the others post events to
+// it, which go through its lock-free mailbox.
+void BM_QueueEventFromOtherThreads( benchmark::State &state )
+{
+	if( state.thread_index() == 0 ) {
+		sMailboxManager = EventManager::create( "Bench", false );
+		sMailboxManager->addListener( makeDelegate( sMailboxListener ), BenchEvent::TYPE );
+	}
+	EventDataRef event = std::make_shared<BenchEvent>();
+	for( auto _ : state ) {
+		if( state.thread_index() == 0 )
+			sMailboxManager->update();
+		else
+			sMailboxManager->queueEvent( event );
+	}
+	state.SetItemsProcessed( state.iterations() );
+	if( state.thread_index() == 0 ) {
+		sMailboxManager->update();
+		sMailboxManager.reset();
+	}
+}
+BENCHMARK( BM_QueueEventFromOtherThreads )->ThreadRange( 2, 8 )->UseRealTime();
+
+// Round trip from queueing an event to an idle service thread until its
+// listener has run. Arg 0 has the thread block in waitAndUpdate(), arg 1 has
+// it poll.
+void BM_WaitAndUpdateWakeLatency( benchmark::State &state )
+{
+	EventManagerRef manager;
+	std::atomic<uint64_t> handled( 0 );
+	std::atomic<bool> isReady( false ), isDone( false );
+	std::thread service( [&] {
+		manager = EventManager::create( "Bench", false );
+		manager->setWaitMode( state.range( 0 ) ? EventManager::WaitMode::POLL : EventManager::WaitMode::BLOCK );
+		manager->addListener( [&]( EventDataRef ) { handled.fetch_add( 1, std::memory_order_release ); }, BenchEvent::TYPE );
+		isReady = true;
+		while( ! isDone )
+			manager->waitAndUpdate();
+	} );
+	while( ! isReady )
+		std::this_thread::yield();
+	EventDataRef event = std::make_shared<BenchEvent>();
+	uint64_t sent = 0;
+	for( auto _ : state ) {
+		manager->queueEvent( event );
+		++sent;
+		while( handled.load( std::memory_order_acquire ) != sent )
+			std::this_thread::yield();
+	}
+	isDone = true;
+	manager->wake();
+	service.join();
+	state.SetItemsProcessed( state.iterations() );
+}
+BENCHMARK( BM_WaitAndUpdateWakeLatency )->Arg( 0 )->Arg( 1 )->UseRealTime();
+
+void BM_InvokeDelegate( benchmark::State &state )
+{
+	Listener listener;
+	EventListenerDelegate delegate = makeDelegate( listener );
+	EventDataRef event = std::make_shared<BenchEvent>();
+	for( auto _ : state ) {
+		benchmark::DoNotOptimize( delegate );
+		delegate( event );
+	}
+	state.SetItemsProcessed( state.iterations() );
+}
+BENCHMARK( BM_InvokeDelegate );
+
+void BM_InvokeFastDelegate( benchmark::State &state )
+{
+	Listener listener;
+	fastdelegate::FastDelegate1<EventDataRef, void> delegate( &listener, &Listener::onEvent );
+	EventDataRef event = std::make_shared<BenchEvent>();
+	for( auto _ : state ) {
+		benchmark::DoNotOptimize( delegate );
+		delegate( event );
+	}
+	state.SetItemsProcessed( state.iterations() );
+}
+BENCHMARK( BM_InvokeFastDelegate );
+
+void BM_InvokeStdFunction( benchmark::State &state )
+{
+	Listener listener;
+	std::function<void( EventDataRef )> function = std::bind( &Listener::onEvent, &listener, std::placeholders::_1 );
+	EventDataRef event = std::make_shared<BenchEvent>();
+	for( auto _ : state ) {
+		benchmark::DoNotOptimize( function );
+		function( event );
+	}
+	state.SetItemsProcessed( state.iterations() );
+}
+BENCHMARK( BM_InvokeStdFunction );
+
+} // anonymous namespace
+
+BENCHMARK_MAIN();
@@ -8,6 +8,8 @@
 
 #pragma once
 
+#include "EventManagerBase.h"
+
 // forward declaration
 using EventDataRef = std::shared_ptr<class EventData>;
 using CircleRef = std::shared_ptr<class Circle>;
@@ -29,15 +31,13 @@ public:
 	Circle( const Circle &other );
 	//! This is the move constructor which is most likely in our
 	//! example what the compiler will choose as the best way to
-	//! construct our vector. For understanding on rvalue references
-	//! and move semantics take a look here...
+	//! construct our vector. It takes over the other circle's
+	//! listener and just points it at this instance. For understanding
+	//! on rvalue references and move semantics take a look here...
 	//! http://thbecker.net/articles/rvalue_references/section_01.html
 	Circle( Circle &&other );
-	//! Because we may need to destruct a "Circle" and as you'll
-	//! see in the implementation we'll be using resources that
-	//! rely on the specific "this" pointer, we need to implement
-	//! a reliable destructor.
-	~Circle();
+	//! There's no need for a destructor. mListener removes our
+	//! listener from the event manager when the circle goes away.
 	
 	//! simple update function
 	void update();
@@ -54,11 +54,15 @@ private:
 	
 	//! This function implements the "hook-in" to the event manager.
 	void initializeListener();
-	//! This function implements the "un-hook" of the event manager.
-	void uninitializeListener();
+	//! Our bounding box as a filter on the click's position, so the event
+	//! manager only calls us for clicks that hit us.
+	EventFilter getBounds() const;
 	
-	ci::ColorAf	mColor;
-	ci::vec2	mPosition;
-	float		mRadius;
-	bool		mIsActivated;
+	ci::ColorAf		mColor;
+	ci::vec2		mPosition;
+	float			mRadius;
+	bool			mIsActivated;
+	//! Our registration with the event manager. It unhooks us when
+	//! it's destroyed.
+	ScopedListener	mListener;
 };
@@ -62,6 +62,19 @@ public:
 	//! know the details of your connection to the internet.
 	virtual void deSerialize( const ci::Buffer &streamIn ) {}
 	
+	//! Fields listeners can filter on with an EventFilter, e.g. a range on
+	//! FIELD_X and FIELD_Y to only hear about clicks inside a rectangle. The
+	//! dispatcher checks them before calling the listener at all.
+	enum FilterField : uint32_t { FIELD_X = 1, FIELD_Y };
+	virtual double getFilterValue( uint32_t field ) const
+	{
+		switch( field ) {
+			case FIELD_X: return mPosition.x;
+			case FIELD_Y: return mPosition.y;
+			default: return EventData::getFilterValue( field );
+		}
+	}
+	
 	//! Getter for position.
 	ci::vec2 getPosition() { return mPosition; }
 	//! Setter for position.
@@ -12,7 +12,6 @@
 #include "cinder/app/App.h"
 #include "cinder/Timeline.h"
 
-#include "FastDelegate.h"
 #include "EventManager.h"
 #include "MousePositionEvent.h"
 
@@ -45,39 +44,35 @@ Circle::Circle( const Circle &other )
 
 Circle::Circle( Circle &&other )
 : mColor( std::move( other.mColor ) ), mPosition( std::move( other.mPosition ) ),
-	mRadius( other.mRadius ), mIsActivated( other.mIsActivated )
+	mRadius( other.mRadius ), mIsActivated( other.mIsActivated ),
+	mListener( std::move( other.mListener ) )
 {
-	cout << "I'm adding " << moveAccum++ << " to the eventManager from move" << endl;
-	other.uninitializeListener();
-	// Just as in the constructor we need to add this instance's delegate to the event
-	// manager's listener list.
-	initializeListener();
-}
-
-Circle::~Circle()
-{
-	// Because we've added this instance as a listener to the event manager. We now need
-	// to remove this as a listener.
-	uninitializeListener();
+	cout << "I'm rebinding " << moveAccum++ << " in the eventManager from move" << endl;
+	// We've taken over the other circle's listener, but its delegate still points at
+	// the other circle. Rebinding updates it in place instead of removing and adding.
+	mListener.rebind( this );
 }
 
 void Circle::initializeListener()
 {
 	// Here's the magic. When a circle is constructed. It immediately adds it's delegate
-	// to the list of listeners. Get the global eventManager for this.
+	// to the list of listeners. Get the current eventManager for this, which is the
+	// global one unless a CurrentEventManagerScope picked another for this thread.
 	auto eventManager = EventManager::get();
 	// check to make sure it's constructed.
 	
 	if( eventManager ) {
 		
-		// create a fast delegate. Fast delegate is similar to a std::function in that it
-		// is a callable entity. It's an "impossibly fast delegate" functor. If you're
-		// interested beyond that check out...
+		// create a delegate. A delegate is similar to a std::function in that it
+		// is a callable entity. It's an "impossibly fast delegate" functor, just an object
+		// pointer and a function pointer. If you're interested beyond that check out...
 		// http://www.codeproject.com/Articles/11015/The-Impossibly-Fast-C-Delegates
-		auto thisListenerDelegate = fastdelegate::MakeDelegate( this, &Circle::mouseEventDelegate );
+		auto thisListenerDelegate = EventListenerDelegate::create<Circle, &Circle::mouseEventDelegate>( this );
 		
-		// then add the delegate and what Type it's listening to to the eventManager
-		eventManager->addListener( thisListenerDelegate, MousePositionEvent::TYPE );
+		// then add the delegate and what Type it's listening to to the eventManager, along
+		// with our bounding box, so only clicks inside it reach us. We keep the returned
+		// token, which removes the listener again when it's destroyed.
+		mListener = eventManager->addScopedListener( thisListenerDelegate, MousePositionEvent::TYPE, getBounds() );
 		
 		// that's basically it. Internally, any time an event of MouseEvent::TYPE is either
 		// queued or triggered, this instance's Circle::mouseEventDelegate function will be
@@ -85,24 +80,22 @@ void Circle::initializeListener()
 	}
 }
 
-void Circle::uninitializeListener()
-{
-	auto eventManager = EventManager::get();
-	if( eventManager ) {
-		auto thisListenerDelegate = fastdelegate::MakeDelegate( this, &Circle::mouseEventDelegate );
-		// just as we call add we call remove.
-		eventManager->removeListener( thisListenerDelegate, MousePositionEvent::TYPE );
-	}
-}
-
 void Circle::update()
 {
 	if( ! mIsActivated ) {
 		mPosition.x += randFloat(-1.0f, 1.0f);
 		mPosition.y += randFloat(-1.0f, 1.0f);
+		// We've moved, so the event manager needs our new bounding box.
+		mListener.setFilter( getBounds() );
 	}
 }
 
+EventFilter Circle::getBounds() const
+{
+	return EventFilter::range( MousePositionEvent::FIELD_X, mPosition.x - mRadius, mPosition.x + mRadius )
+		.andRange( MousePositionEvent::FIELD_Y, mPosition.y - mRadius, mPosition.y + mRadius );
+}
+
 void Circle::draw()
 {
 	gl::color( mColor );
@@ -123,18 +116,16 @@ void Circle::mouseEventDelegate( EventDataRef eventData )
 	// check whether the pointer is correct...
 	// if( ! mouseEvent ) return;
 	
-	// now you can get the event's data and work with it.
+	// now you can get the event's data and work with it. The event manager already
+	// checked the click against our bounding box, so we know it's a hit.
 	auto pos = mouseEvent->getPosition();
 	
-	if( pos.x < mPosition.x + mRadius && pos.x > mPosition.x - mRadius &&
-	   pos.y < mPosition.y + mRadius && pos.y > mPosition.y - mRadius ) {
-		cout << "I picked a circle" << endl;
-		cout << "MousePosition: " << pos << " Position: " << mPosition << " Radius: " << mRadius << endl;
-		activate();
-		// We don't want this event to continue so we're going to mark it as handled.
-		// This'll deactivate the event in the eventManager.
-		mouseEvent->setIsHandled( true );
-	}
+	cout << "I picked a circle" << endl;
+	cout << "MousePosition: " << pos << " Position: " << mPosition << " Radius: " << mRadius << endl;
+	activate();
+	// We don't want this event to continue so we're going to mark it as handled.
+	// This'll deactivate the event in the eventManager.
+	mouseEvent->setIsHandled( true );
 }
 
 void Circle::activate()
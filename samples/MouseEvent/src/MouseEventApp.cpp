@@ -34,6 +34,10 @@ void MouseEventApp::setup()
 	// we first initialize the eventManager that we'll be using, Give it a name
 	// and we'll be making this global so I'm passing it true.
 	mEventManager = EventManager::create( "Global", true );
+	// Circles register their bounding boxes as filters, so we can have the
+	// manager route each click through a grid to just the circles near it
+	// instead of asking every circle whether it was hit.
+	mEventManager->setSpatialIndex( MousePositionEvent::TYPE, MousePositionEvent::FIELD_X, MousePositionEvent::FIELD_Y, 32 );
 	// I know the number of Circles that i have and I want to use move semantics
 	// so I first reserve space for that number. If you were to remove this line
 	// you'd see that the Circles Copy Constructor is called, because of the
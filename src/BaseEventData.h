@@ -8,30 +8,71 @@
 
 #pragma once
 
+#include <limits>
 #include <memory>
 
-#include "cinder/Buffer.h"
+#include "EventConfig.h"
+#include "EventPayloadView.h"
 
 using EventDataRef = std::shared_ptr<class EventData>;
 using EventType = uint64_t;
+//! Root of every event type hierarchy. Listeners of ANY_EVENT_TYPE receive
+//! every event.
+const EventType ANY_EVENT_TYPE = ~EventType( 0 );
+//! Secondary subscription key within an event type, e.g. an entity id.
+using EventKey = uint64_t;
+const EventKey NO_EVENT_KEY = ~EventKey( 0 );
 	
 class EventData {
 public:
-	explicit EventData( float timestamp = 0.0f ) : mTimeStamp( timestamp ), mIsHandled( false ) {}
+	explicit EventData( float timestamp = 0.0f ) : mTimeStamp( timestamp ), mIsHandled( false ), mCorrelationId( 0 ) {}
 	virtual ~EventData() {}
 
 	virtual EventDataRef copy() = 0;
 	virtual const char* getName() const = 0;
 	virtual EventType getEventType() const = 0;
+	//! Routes this event to listeners subscribed to one key of its type, as
+	//! well as to the listeners of the whole type. Defaults to NO_EVENT_KEY.
+	virtual EventKey getEventKey() const { return NO_EVENT_KEY; }
 	float getTimeStamp() { return mTimeStamp; }
 	
 	bool isHandled() { return mIsHandled; }
 	void setIsHandled( bool handled = true ) { mIsHandled = handled; }
 	
-	virtual void serialize( ci::Buffer &streamOut ) = 0;
-	virtual void deSerialize( const ci::Buffer &streamIn ) = 0;
+	//! Pairs a request with its reply, see EventManager::request(). 0 for
+	//! events that aren't part of a request. Not serialized.
+	uint64_t getCorrelationId() const { return mCorrelationId; }
+	void setCorrelationId( uint64_t id ) { mCorrelationId = id; }
+	//! Marks this event as the reply to \a request.
+	void replyTo( const EventData &request ) { mCorrelationId = request.mCorrelationId; }
+	
+	//! Returns the value of filter \a field for EventFilter clauses, or NaN if
+	//! this event has no such field. Field ids are defined per event type.
+	//! Called once per field per dispatch, not once per listener.
+	virtual double getFilterValue( uint32_t /*field*/ ) const { return std::numeric_limits<double>::quiet_NaN(); }
+	
+	virtual void serialize( EventBuffer &streamOut ) = 0;
+	virtual void deSerialize( const EventBuffer &streamIn ) = 0;
+	
+	//! Zero-copy alternative to deSerialize(). The view keeps the receive or
+	//! journal buffer alive, so events that override this to hold on to the
+	//! view and decode fields lazily never copy their payload. The default
+	//! keeps the view and hands its bytes, in place, to deSerialize().
+	virtual void attachPayload( const EventPayloadView &payload )
+	{
+		mPayload = payload;
+		deSerialize( payload.asBuffer() );
+	}
+	//! Returns the payload attached with attachPayload(), if any. Forwarding
+	//! code can write these bytes out directly instead of re-serializing.
+	const EventPayloadView& getPayload() const { return mPayload; }
+	bool hasPayload() const { return ! mPayload.empty(); }
+	
+protected:
+	EventPayloadView	mPayload;
 	
 private:
 	const float mTimeStamp;
 	bool		mIsHandled;
+	uint64_t	mCorrelationId;
 };
\ No newline at end of file
@@ -0,0 +1,91 @@
+//
+//  Delegate.h
+//  Cinder-EventManager
+//
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+template<typename Signature>
+class Delegate;
+
+//! A standards-conforming fast delegate: an object pointer plus a pointer to a
+//! thunk that casts the object back and calls the bound function. The callee
+//! is a template argument, so it is baked into the thunk instead of being
+//! stored as a member function pointer. That keeps every delegate at two
+//! pointers, trivially copyable (listener arrays can be memcpy'd) and
+//! constexpr-constructible, without FastDelegate's compiler-specific casts.
+//!
+//! \code
+//! auto delegate = Delegate<void( EventDataRef )>::create<Circle, &Circle::mouseEventDelegate>( this );
+//! \endcode
+template<typename R, typename... Args>
+class Delegate<R( Args... )> {
+public:
+	using Thunk = R (*)( void*, Args... );
+
+	constexpr Delegate() noexcept : mObject( nullptr ), mThunk( nullptr ) {}
+	//! Binds an arbitrary thunk. \a thunk receives \a object as its first argument.
+	constexpr Delegate( void *object, Thunk thunk ) noexcept : mObject( object ), mThunk( thunk ) {}
+
+	//! Binds a member function of \a object.
+	template<typename T, R (T::*Method)( Args... )>
+	static constexpr Delegate create( T *object ) noexcept { return Delegate( object, &methodThunk<T, Method> ); }
+	//! Binds a const member function of \a object.
+	template<typename T, R (T::*Method)( Args... ) const>
+	static constexpr Delegate create( const T *object ) noexcept { return Delegate( const_cast<T*>( object ), &constMethodThunk<T, Method> ); }
+	//! Binds a free or static function.
+	template<R (*Function)( Args... )>
+	static constexpr Delegate create() noexcept { return Delegate( nullptr, &functionThunk<Function> ); }
+
+	R operator()( Args... args ) const { return mThunk( mObject, std::forward<Args>( args )... ); }
+
+	constexpr bool empty() const noexcept { return mThunk == nullptr; }
+	constexpr explicit operator bool() const noexcept { return mThunk != nullptr; }
+	void clear() noexcept { mObject = nullptr; mThunk = nullptr; }
+
+	//! The bound object, or nullptr for free functions.
+	constexpr void* getObject() const noexcept { return mObject; }
+	constexpr Thunk getThunk() const noexcept { return mThunk; }
+
+	constexpr bool operator==( const Delegate &other ) const noexcept { return mObject == other.mObject && mThunk == other.mThunk; }
+	constexpr bool operator!=( const Delegate &other ) const noexcept { return ! ( *this == other ); }
+
+	//! Hashes the (object, function) identity, consistent with operator==.
+	//! Stable for the lifetime of the process.
+	size_t hash() const noexcept
+	{
+		uint64_t key = uint64_t( reinterpret_cast<uintptr_t>( mObject ) ) * 0x9e3779b97f4a7c15ull
+			^ uint64_t( reinterpret_cast<uintptr_t>( mThunk ) );
+		key ^= key >> 32; key *= 0xd6e8feb86659fd93ull;
+		key ^= key >> 32;
+		return static_cast<size_t>( key );
+	}
+
+private:
+	template<typename T, R (T::*Method)( Args... )>
+	static R methodThunk( void *object, Args... args ) { return ( static_cast<T*>( object )->*Method )( std::forward<Args>( args )... ); }
+	template<typename T, R (T::*Method)( Args... ) const>
+	static R constMethodThunk( void *object, Args... args ) { return ( static_cast<const T*>( object )->*Method )( std::forward<Args>( args )... ); }
+	template<R (*Function)( Args... )>
+	static R functionThunk( void *, Args... args ) { return Function( std::forward<Args>( args )... ); }
+
+	void	*mObject;
+	Thunk	mThunk;
+};
+
+namespace std {
+	template<typename Signature>
+	struct hash<Delegate<Signature>> {
+		size_t operator()( const Delegate<Signature> &delegate ) const noexcept { return delegate.hash(); }
+	};
+}
+
+static_assert( std::is_trivially_copyable<Delegate<void()>>::value, "Delegate must stay trivially copyable" );
+static_assert( sizeof( Delegate<void()> ) == 2 * sizeof( void* ), "Delegate must stay two pointers wide" );
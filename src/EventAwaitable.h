@@ -0,0 +1,130 @@
+//
+//  EventAwaitable.h
+//  Cinder-EventManager
+//
+//
+
+#pragma once
+
+// Coroutine support for waiting on events. Only compiled when the compiler
+// supports C++20 coroutines; the rest of the event system stays C++14.
+
+#if defined( __cpp_impl_coroutine ) && defined( __has_include )
+#if __has_include( <coroutine> )
+
+#define EVENT_MANAGER_HAS_COROUTINES
+
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <utility>
+
+#include "EventManagerBase.h"
+
+//! Predicate that accepts every event, the default for EventManagerBase::next().
+struct AnyEvent {
+	template<typename EventT>
+	bool operator()( const EventT & ) const { return true; }
+};
+
+//! Suspends a coroutine until the next event of EventT::TYPE that passes a
+//! predicate, then resumes it from inside that event's dispatch, i.e. from
+//! update() for queued events. co_await yields the event as a
+//! std::shared_ptr<EventT>. The awaitable lives in the coroutine frame and
+//! registers a listener that only captures a pointer to it, so waiting
+//! allocates nothing beyond the frame. Destroying a suspended coroutine
+//! removes its listener, and destroying the manager destroys the coroutines
+//! still waiting on it. If the listener can't be registered the coroutine
+//! carries on at once and co_await yields nullptr.
+//!
+//! \code
+//! EventTask Circle::blink()
+//! {
+//!		auto click = co_await manager->next<MousePositionEvent>( [this]( const MousePositionEvent &event ) { return hits( event ); } );
+//!		...
+//! }
+//! \endcode
+template<typename EventT, typename Predicate>
+class EventAwaitable : public EventAwaiter {
+public:
+	EventAwaitable( EventManagerBase &manager, Predicate predicate )
+	: mManager( manager ), mPredicate( std::move( predicate ) ) {}
+	~EventAwaitable()
+	{
+		if( mListener ) {
+			mManager.removeListener( mListener );
+			mManager.removePendingAwaiter( this );
+		}
+	}
+
+	EventAwaitable( const EventAwaitable & ) = delete;
+	EventAwaitable& operator=( const EventAwaitable & ) = delete;
+
+	bool await_ready() const noexcept { return false; }
+	bool await_suspend( std::coroutine_handle<> handle )
+	{
+		mHandle = handle;
+		auto self = this;
+		mListener = mManager.addListener( [self]( EventDataRef event ) { self->onEvent( event ); }, EventT::TYPE );
+		// Without a listener nothing would resume the coroutine.
+		if( ! mListener )
+			return false;
+		mManager.addPendingAwaiter( this );
+		return true;
+	}
+	std::shared_ptr<EventT> await_resume() { return std::move( mEvent ); }
+
+	void destroyCoroutine() override
+	{
+		// The manager clears its listeners itself. The frame holds this
+		// awaitable, so destroying it has to come last.
+		mListener = EventListenerHandle();
+		mHandle.destroy();
+	}
+
+private:
+	void onEvent( const EventDataRef &event )
+	{
+		// Subtypes of EventT::TYPE reach its listeners too, so check the cast.
+		auto typed = std::dynamic_pointer_cast<EventT>( event );
+		if( ! typed || ! mPredicate( *typed ) )
+			return;
+		mEvent = std::move( typed );
+		mManager.removeListener( mListener );
+		mManager.removePendingAwaiter( this );
+		mListener = EventListenerHandle();
+		// The coroutine may finish and destroy this awaitable, so resuming
+		// has to come last.
+		mHandle.resume();
+	}
+
+	EventManagerBase			&mManager;
+	Predicate					mPredicate;
+	EventListenerHandle			mListener;
+	std::coroutine_handle<>		mHandle;
+	std::shared_ptr<EventT>		mEvent;
+};
+
+//! Minimal fire-and-forget coroutine type for event sequences. The coroutine
+//! starts running immediately and its frame frees itself when it finishes,
+//! or when the manager it's waiting on is destroyed.
+//! Exceptions escaping it terminate.
+class EventTask {
+public:
+	struct promise_type {
+		EventTask get_return_object() noexcept { return {}; }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() noexcept {}
+		void unhandled_exception() noexcept { std::terminate(); }
+	};
+};
+
+template<typename EventT, typename Predicate>
+EventAwaitable<EventT, Predicate> EventManagerBase::next( Predicate predicate )
+{
+	return EventAwaitable<EventT, Predicate>( *this, std::move( predicate ) );
+}
+
+#endif
+#endif
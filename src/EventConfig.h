@@ -0,0 +1,87 @@
+//
+//  EventConfig.h
+//  Cinder-EventManager
+//
+//
+
+#pragma once
+
+// By default the event system is built as a Cinder block and uses Cinder's
+// Buffer, logging and asserts. Defining EVENT_MANAGER_NO_CINDER swaps those
+// for the minimal stand-ins below so the core can be built headless, e.g. for
+// services, benchmarks and test executables.
+
+#if ! defined( EVENT_MANAGER_NO_CINDER )
+
+#include "cinder/Buffer.h"
+#include "cinder/Log.h"
+#include "cinder/CinderAssert.h"
+
+using EventBuffer = ci::Buffer;
+
+#else
+
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <utility>
+
+//! Stand-in for ci::Buffer. Either owns a heap block or wraps caller memory.
+class EventBuffer {
+public:
+	EventBuffer() : mData( nullptr ), mSize( 0 ) {}
+	//! Allocates and owns \a size bytes.
+	explicit EventBuffer( size_t size )
+	: mOwned( new uint8_t[size] ), mData( mOwned.get() ), mSize( size ) {}
+	//! Wraps \a size bytes at \a data without taking ownership.
+	EventBuffer( void *data, size_t size ) : mData( static_cast<uint8_t*>( data ) ), mSize( size ) {}
+
+	//! Moving leaves \a other empty rather than pointing into storage it no
+	//! longer owns.
+	EventBuffer( EventBuffer &&other ) noexcept
+	: mOwned( std::move( other.mOwned ) ), mData( other.mData ), mSize( other.mSize )
+	{
+		other.mData = nullptr;
+		other.mSize = 0;
+	}
+	EventBuffer& operator=( EventBuffer &&other ) noexcept
+	{
+		if( this != &other ) {
+			mOwned = std::move( other.mOwned );
+			mData = other.mData;
+			mSize = other.mSize;
+			other.mData = nullptr;
+			other.mSize = 0;
+		}
+		return *this;
+	}
+
+	void*		getData() { return mData; }
+	const void*	getData() const { return mData; }
+	size_t		getSize() const { return mSize; }
+
+private:
+	std::unique_ptr<uint8_t[]>	mOwned;
+	uint8_t*					mData;
+	size_t						mSize;
+};
+
+#if ! defined( CI_LOG_E )
+	#define CI_LOG_E( stream )	( std::cerr << "|error  | " << stream << std::endl )
+	#define CI_LOG_W( stream )	( std::cerr << "|warning| " << stream << std::endl )
+	#if defined( EVENT_MANAGER_LOG_INFO )
+		#define CI_LOG_I( stream )	( std::clog << "|info   | " << stream << std::endl )
+		#define CI_LOG_V( stream )	( std::clog << "|verbose| " << stream << std::endl )
+	#else
+		#define CI_LOG_I( stream )	((void)0)
+		#define CI_LOG_V( stream )	((void)0)
+	#endif
+#endif
+
+#if ! defined( CI_ASSERT )
+	#define CI_ASSERT( expr )	assert( expr )
+#endif
+
+#endif
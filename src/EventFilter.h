@@ -0,0 +1,69 @@
+//
+//  EventFilter.h
+//  Cinder-EventManager
+//
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "EventConfig.h"
+
+//! A cheap test on an event's filter fields, checked by the dispatcher before
+//! a listener is called. Listeners whose filter fails are skipped without an
+//! indirect call or a cast of the event. A filter is the conjunction of up to
+//! kMaxClauses clauses, each requiring one field to lie in a closed range, e.g.
+//! a box over two fields plus a key. A filter given more clauses is invalid,
+//! and listeners can't be registered with it.
+//! Events supply their fields through EventData::getFilterValue(); a field the
+//! event doesn't supply fails every clause that tests it.
+//!
+//! \code
+//! manager->addListener( delegate, MousePositionEvent::TYPE,
+//!		EventFilter::range( MousePositionEvent::FIELD_X, 0, 100 ).andRange( MousePositionEvent::FIELD_Y, 0, 100 ) );
+//! \endcode
+class EventFilter {
+public:
+	static const size_t kMaxClauses = 4;
+
+	struct Clause {
+		uint32_t	mField;
+		double		mMin;
+		double		mMax;
+	};
+
+	//! An empty filter, which passes every event.
+	EventFilter() : mNumClauses( 0 ), mIsOverflowed( false ) {}
+
+	//! Passes events whose \a field equals \a value.
+	static EventFilter equal( uint32_t field, double value ) { return EventFilter().andEqual( field, value ); }
+	//! Passes events whose \a field lies in [\a min, \a max].
+	static EventFilter range( uint32_t field, double min, double max ) { return EventFilter().andRange( field, min, max ); }
+	//! Passes events whose \a field equals \a key. Keys are compared as
+	//! doubles, so they must be below 2^53 to compare exactly.
+	static EventFilter key( uint32_t field, uint64_t key ) { return EventFilter().andKey( field, key ); }
+
+	EventFilter& andEqual( uint32_t field, double value ) { return andRange( field, value, value ); }
+	EventFilter& andRange( uint32_t field, double min, double max )
+	{
+		if( mNumClauses < kMaxClauses )
+			mClauses[mNumClauses++] = { field, min, max };
+		else
+			mIsOverflowed = true;
+		return *this;
+	}
+	EventFilter& andKey( uint32_t field, uint64_t key ) { return andEqual( field, static_cast<double>( key ) ); }
+
+	bool			empty() const { return mNumClauses == 0; }
+	//! False once more than kMaxClauses clauses were added.
+	bool			isValid() const { return ! mIsOverflowed; }
+	size_t			getNumClauses() const { return mNumClauses; }
+	const Clause&	getClause( size_t index ) const { return mClauses[index]; }
+
+private:
+	Clause	mClauses[kMaxClauses];
+	size_t	mNumClauses;
+	bool	mIsOverflowed;
+};
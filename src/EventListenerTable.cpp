@@ -0,0 +1,904 @@
+//
+//  EventListenerTable.cpp
+//  Cinder-EventManager
+//
+//
+
+#include "EventListenerTable.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined( __AVX2__ ) || defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+	#include <immintrin.h>
+	#define EVENT_MANAGER_FILTER_SSE2
+#endif
+
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////////////////////
+// EventListenerPool
+
+EventListenerPool& EventListenerPool::get()
+{
+	// Intentionally leaked so listeners released during static destruction,
+	// e.g. by a global EventManagerRef, still have a pool to return to.
+	static EventListenerPool *sPool = new EventListenerPool;
+	return *sPool;
+}
+
+EventListenerPool::EventListenerPool()
+{
+	mFreeLists.fill( nullptr );
+}
+
+size_t EventListenerPool::getSizeClass( size_t size )
+{
+	return size <= 64 ? 0 : size <= 128 ? 1 : 2;
+}
+
+void* EventListenerPool::allocate( size_t size )
+{
+	if( size > kMaxBlockSize )
+		return ::operator new( size );
+
+	auto sizeClass = getSizeClass( size );
+	lock_guard<mutex> lock( mMutex );
+	if( ! mFreeLists[sizeClass] ) {
+		const size_t blockSize = size_t( 64 ) << sizeClass;
+		mChunks.emplace_back( new unsigned char[blockSize * kBlocksPerChunk] );
+		auto chunk = mChunks.back().get();
+		for( size_t i = 0; i < kBlocksPerChunk; ++i ) {
+			auto block = reinterpret_cast<FreeBlock*>( chunk + i * blockSize );
+			block->mNext = mFreeLists[sizeClass];
+			mFreeLists[sizeClass] = block;
+		}
+	}
+	auto block = mFreeLists[sizeClass];
+	mFreeLists[sizeClass] = block->mNext;
+	return block;
+}
+
+void EventListenerPool::deallocate( void *block, size_t size )
+{
+	if( size > kMaxBlockSize ) {
+		::operator delete( block );
+		return;
+	}
+
+	auto sizeClass = getSizeClass( size );
+	lock_guard<mutex> lock( mMutex );
+	auto freeBlock = static_cast<FreeBlock*>( block );
+	freeBlock->mNext = mFreeLists[sizeClass];
+	mFreeLists[sizeClass] = freeBlock;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+// EventListenerTable
+
+EventListenerTable::~EventListenerTable()
+{
+	for( auto &listener : mListeners )
+		listener.release();
+	for( auto &listener : mPending )
+		listener.release();
+}
+
+uint64_t EventListenerTable::add( const EventListener &listener, const EventFilter &filter )
+{
+	if( ! filter.isValid() ) {
+		CI_LOG_E( "Listener filter exceeds " << EventFilter::kMaxClauses << " clauses" );
+		EventListener rejected = listener;
+		rejected.release();
+		return 0;
+	}
+	if( ! addFilterFields( filter ) ) {
+		CI_LOG_E( "Listener filter exceeds " << kMaxFilterFields << " distinct fields per event type" );
+		EventListener rejected = listener;
+		rejected.release();
+		return 0;
+	}
+
+	uint32_t index;
+	if( ! mFreeHandles.empty() ) {
+		index = mFreeHandles.back();
+		mFreeHandles.pop_back();
+	}
+	else {
+		index = static_cast<uint32_t>( mHandles.size() );
+		mHandles.push_back( { kFreeSlot, 0 } );
+	}
+
+	auto &handle = mHandles[index];
+	uint64_t id = ( uint64_t( handle.mGeneration ) << 32 ) | ( uint64_t( index ) + 1 );
+
+	if( mDispatchDepth > 0 ) {
+		handle.mSlot = kPendingSlot | static_cast<uint32_t>( mPending.size() );
+		mPending.push_back( listener );
+		mPending.back().mId = id;
+		mPendingFilters.push_back( filter );
+	}
+	else {
+		handle.mSlot = static_cast<uint32_t>( mListeners.size() );
+		append( listener, filter );
+		mListeners.back().mId = id;
+	}
+	if( ! listener.isCallable() )
+		mDelegateIds[listener.mDelegate] = id;
+	++mNumLive;
+	return id;
+}
+
+EventListener* EventListenerTable::find( uint64_t id )
+{
+	// Ids pack the handle's generation in the high word and its index + 1 in
+	// the low word, so 0 is never a valid id.
+	uint32_t index = getHandleIndex( id );
+	if( ! id || index >= mHandles.size() )
+		return nullptr;
+	const auto &handle = mHandles[index];
+	if( handle.mGeneration != uint32_t( id >> 32 ) || handle.mSlot == kFreeSlot )
+		return nullptr;
+	if( handle.mSlot & kPendingSlot )
+		return &mPending[handle.mSlot & ~kPendingSlot];
+	return &mListeners[handle.mSlot];
+}
+
+bool EventListenerTable::remove( uint64_t id )
+{
+	auto listener = find( id );
+	if( ! listener || listener->isRemoved() )
+		return false;
+	removeAt( *listener, getHandleIndex( id ) );
+	compactIfSparse();
+	return true;
+}
+
+bool EventListenerTable::remove( const EventListenerDelegate &delegate )
+{
+	auto found = mDelegateIds.find( delegate );
+	return found != mDelegateIds.end() && remove( found->second );
+}
+
+bool EventListenerTable::contains( const EventListenerDelegate &delegate ) const
+{
+	return mDelegateIds.count( delegate ) != 0;
+}
+
+uint64_t EventListenerTable::getId( const EventListenerDelegate &delegate ) const
+{
+	auto found = mDelegateIds.find( delegate );
+	return found != mDelegateIds.end() ? found->second : 0;
+}
+
+const EventListener* EventListenerTable::get( uint64_t id ) const
+{
+	auto listener = const_cast<EventListenerTable*>( this )->find( id );
+	return listener && ! listener->isRemoved() ? listener : nullptr;
+}
+
+bool EventListenerTable::rebind( uint64_t id, void *object )
+{
+	auto listener = find( id );
+	if( ! listener || listener->isRemoved() || listener->isCallable() )
+		return false;
+	EventListenerDelegate delegate( object, listener->mDelegate.getThunk() );
+	if( delegate == listener->mDelegate )
+		return true;
+	if( ! mDelegateIds.emplace( delegate, id ).second )
+		return false;
+	mDelegateIds.erase( listener->mDelegate );
+	listener->mDelegate = delegate;
+	return true;
+}
+
+bool EventListenerTable::setFilter( uint64_t id, const EventFilter &filter )
+{
+	auto listener = find( id );
+	if( ! listener || listener->isRemoved() )
+		return false;
+	if( ! filter.isValid() ) {
+		CI_LOG_E( "Listener filter exceeds " << EventFilter::kMaxClauses << " clauses" );
+		return false;
+	}
+	if( ! addFilterFields( filter ) ) {
+		CI_LOG_E( "Listener filter exceeds " << kMaxFilterFields << " distinct fields per event type" );
+		return false;
+	}
+	auto slot = mHandles[getHandleIndex( id )].mSlot;
+	if( slot & kPendingSlot ) {
+		mPendingFilters[slot & ~kPendingSlot] = filter;
+		return true;
+	}
+	if( ! mHasFilters ) {
+		if( filter.empty() )
+			return true;
+		mFilterColumns.resize( mListeners.size() );
+		mHasFilters = true;
+	}
+	// A running dispatch may be walking the cells, so they're left alone
+	// until it ends.
+	const bool regrid = mGrid && mDispatchDepth == 0;
+	if( regrid )
+		eraseFromGrid( slot );
+	mFilterColumns.set( slot, getFilterFieldIndices( filter ), filter );
+	if( regrid )
+		insertIntoGrid( slot );
+	else if( mGrid )
+		mGrid->mIsStale = true;
+	return true;
+}
+
+void EventListenerTable::removeAt( EventListener &listener, uint32_t index )
+{
+	// The handle is retired immediately so stale ids stop resolving, but the
+	// slot itself, and a pooled callable that may be running right now, are
+	// only reclaimed by compact() once no dispatch is in progress.
+	auto &handle = mHandles[index];
+	handle.mSlot = kFreeSlot;
+	++handle.mGeneration;
+	mFreeHandles.push_back( index );
+
+	if( ! listener.isCallable() )
+		mDelegateIds.erase( listener.mDelegate );
+	listener.mFlags |= EventListener::REMOVED;
+	--mNumLive;
+	++mNumRemoved;
+}
+
+void EventListenerTable::clear()
+{
+	for( auto *listeners : { &mListeners, &mPending } ) {
+		for( auto &listener : *listeners ) {
+			if( ! listener.isRemoved() )
+				removeAt( listener, getHandleIndex( listener.mId ) );
+		}
+	}
+	compactIfSparse();
+}
+
+size_t EventListenerTable::removeExpired()
+{
+	if( ! mHasExpired )
+		return 0;
+	mHasExpired = false;
+	size_t removed = 0;
+	for( auto &listener : mListeners ) {
+		if( listener.isExpired() && ! listener.isRemoved() ) {
+			removeAt( listener, getHandleIndex( listener.mId ) );
+			++removed;
+		}
+	}
+	compactIfSparse();
+	return removed;
+}
+
+void EventListenerTable::endDispatch()
+{
+	if( ! mPending.empty() ) {
+		for( size_t i = 0; i < mPending.size(); ++i ) {
+			auto &listener = mPending[i];
+			if( ! listener.isRemoved() )
+				mHandles[getHandleIndex( listener.mId )].mSlot = static_cast<uint32_t>( mListeners.size() );
+			append( listener, mPendingFilters[i] );
+		}
+		mPending.clear();
+		mPendingFilters.clear();
+	}
+	compactIfSparse();
+	if( mGrid && mGrid->mIsStale && mDispatchDepth == 0 )
+		rebuildGrid();
+}
+
+void EventListenerTable::append( const EventListener &listener, const EventFilter &filter )
+{
+	if( mIsSorted && ! mListeners.empty() && getTarget( listener ) < getTarget( mListeners.back() ) )
+		mIsSorted = false;
+	// Columns are only kept once a table has a filtered listener, so tables
+	// without filters dispatch exactly as before.
+	if( ! mHasFilters && ! filter.empty() ) {
+		mFilterColumns.resize( mListeners.size() );
+		mHasFilters = true;
+	}
+	mListeners.push_back( listener );
+	if( mHasFilters )
+		mFilterColumns.push( getFilterFieldIndices( filter ), filter );
+	if( mGrid )
+		insertIntoGrid( static_cast<uint32_t>( mListeners.size() - 1 ) );
+}
+
+bool EventListenerTable::addFilterFields( const EventFilter &filter )
+{
+	array<uint32_t, EventFilter::kMaxClauses> added;
+	size_t numAdded = 0;
+	for( size_t c = 0; c < filter.getNumClauses(); ++c ) {
+		auto field = filter.getClause( c ).mField;
+		if( std::find( mFilterFieldIds.begin(), mFilterFieldIds.end(), field ) == mFilterFieldIds.end()
+		   && std::find( added.begin(), added.begin() + numAdded, field ) == added.begin() + numAdded )
+			added[numAdded++] = field;
+	}
+	if( mFilterFieldIds.size() + numAdded > kMaxFilterFields )
+		return false;
+	mFilterFieldIds.insert( mFilterFieldIds.end(), added.begin(), added.begin() + numAdded );
+	return true;
+}
+
+EventListenerTable::FilterColumns::FieldIndices EventListenerTable::getFilterFieldIndices( const EventFilter &filter ) const
+{
+	// Index 0 is the constant slot; field i is loaded into slot i + 1.
+	FilterColumns::FieldIndices indices;
+	indices.fill( 0 );
+	for( size_t c = 0; c < filter.getNumClauses(); ++c ) {
+		auto found = std::find( mFilterFieldIds.begin(), mFilterFieldIds.end(), filter.getClause( c ).mField );
+		indices[c] = static_cast<uint8_t>( found - mFilterFieldIds.begin() + 1 );
+	}
+	return indices;
+}
+
+void EventListenerTable::loadFilterValues( const EventData &event, double *values ) const
+{
+	values[0] = 0.0;
+	for( size_t i = 0; i < mFilterFieldIds.size(); ++i )
+		values[i + 1] = event.getFilterValue( mFilterFieldIds[i] );
+	std::fill( values + mFilterFieldIds.size() + 1, values + kMaxFilterFields + 1, numeric_limits<double>::quiet_NaN() );
+}
+
+void EventListenerTable::compactIfSparse()
+{
+	if( mDispatchDepth == 0 && mNumRemoved > mNumLive / 2 )
+		compact();
+}
+
+void EventListenerTable::compact()
+{
+	size_t write = 0;
+	for( size_t read = 0; read < mListeners.size(); ++read ) {
+		auto &listener = mListeners[read];
+		if( listener.isRemoved() ) {
+			listener.release();
+			continue;
+		}
+		if( write != read ) {
+			mListeners[write] = listener;
+			mHandles[getHandleIndex( listener.mId )].mSlot = static_cast<uint32_t>( write );
+			if( mHasFilters )
+				mFilterColumns.move( read, write );
+		}
+		++write;
+	}
+	mListeners.resize( write );
+	if( mHasFilters )
+		mFilterColumns.resize( write );
+	mNumRemoved = 0;
+	if( mGrid )
+		rebuildGrid();
+}
+
+bool EventListenerTable::needsDefragment( bool sortByTarget ) const
+{
+	if( mDispatchDepth > 0 )
+		return false;
+	return mNumRemoved > 0 || ( sortByTarget && ! mIsSorted ) || mListeners.capacity() > 2 * mListeners.size() + 16;
+}
+
+void EventListenerTable::defragment( bool sortByTarget )
+{
+	if( mDispatchDepth > 0 )
+		return;
+	if( mNumRemoved > 0 )
+		compact();
+	if( sortByTarget && ! mIsSorted ) {
+		// Sort an order rather than the slots so the filter columns can follow.
+		vector<uint32_t> order( mListeners.size() );
+		for( size_t i = 0; i < order.size(); ++i )
+			order[i] = static_cast<uint32_t>( i );
+		stable_sort( order.begin(), order.end(), [this]( uint32_t a, uint32_t b ) {
+			return getTarget( mListeners[a] ) < getTarget( mListeners[b] );
+		} );
+		vector<EventListener> sorted( mListeners.size() );
+		for( size_t i = 0; i < order.size(); ++i ) {
+			sorted[i] = mListeners[order[i]];
+			mHandles[getHandleIndex( sorted[i].mId )].mSlot = static_cast<uint32_t>( i );
+		}
+		mListeners.swap( sorted );
+		if( mHasFilters )
+			mFilterColumns.permute( order );
+		if( mGrid )
+			rebuildGrid();
+		mIsSorted = true;
+	}
+	if( mListeners.capacity() > 2 * mListeners.size() + 16 )
+		mListeners.shrink_to_fit();
+}
+
+void EventListenerTable::addStats( EventListenerStats &stats ) const
+{
+	++stats.mNumTables;
+	stats.mNumListeners += mNumLive;
+	stats.mNumHoles += mListeners.size() + mPending.size() - mNumLive;
+	stats.mCapacity += mListeners.capacity();
+	if( ! mIsSorted )
+		++stats.mNumUnsortedTables;
+}
+
+void EventListenerTable::setSpatialIndex( uint32_t xField, uint32_t yField, double cellSize )
+{
+	CI_ASSERT( mDispatchDepth == 0 );
+	if( ! ( cellSize > 0.0 ) ) {
+		mGrid.reset();
+		return;
+	}
+	if( ! mHasFilters ) {
+		mFilterColumns.resize( mListeners.size() );
+		mHasFilters = true;
+	}
+	mGrid.reset( new SpatialGrid );
+	mGrid->mXField = xField;
+	mGrid->mYField = yField;
+	mGrid->mInvCellSize = 1.0 / cellSize;
+	rebuildGrid();
+}
+
+bool EventListenerTable::getCell( double value, int64_t &cell ) const
+{
+	// Cells past +-2^31 would alias once packed into a key.
+	const double scaled = std::floor( value * mGrid->mInvCellSize );
+	if( ! ( std::abs( scaled ) < 2147483648.0 ) )
+		return false;
+	cell = static_cast<int64_t>( scaled );
+	return true;
+}
+
+bool EventListenerTable::getCellRange( size_t slot, CellRange &range ) const
+{
+	bool hasX = false, hasY = false;
+	for( size_t c = 0; c < EventFilter::kMaxClauses; ++c ) {
+		auto index = mFilterColumns.mFields[c][slot];
+		if( ! index )
+			continue;
+		auto field = mFilterFieldIds[index - 1];
+		auto min = mFilterColumns.mMins[c][slot], max = mFilterColumns.mMaxs[c][slot];
+		if( field == mGrid->mXField && ! hasX )
+			hasX = getCell( min, range.mX0 ) && getCell( max, range.mX1 );
+		else if( field == mGrid->mYField && ! hasY )
+			hasY = getCell( min, range.mY0 ) && getCell( max, range.mY1 );
+	}
+	if( ! hasX || ! hasY )
+		return false;
+	if( range.mX1 < range.mX0 || range.mY1 < range.mY0 )
+		return true;
+	return uint64_t( range.mX1 - range.mX0 + 1 ) * uint64_t( range.mY1 - range.mY0 + 1 ) <= kMaxGridCellsPerListener;
+}
+
+const vector<uint32_t>* EventListenerTable::findCell( const EventData &event ) const
+{
+	int64_t x, y;
+	if( ! getCell( event.getFilterValue( mGrid->mXField ), x ) || ! getCell( event.getFilterValue( mGrid->mYField ), y ) )
+		return nullptr;
+	auto found = mGrid->mCells.find( getCellKey( x, y ) );
+	return found != mGrid->mCells.end() ? &found->second : nullptr;
+}
+
+void EventListenerTable::insertIntoGrid( uint32_t slot )
+{
+	CellRange range;
+	if( ! getCellRange( slot, range ) ) {
+		mGrid->mUnindexed.push_back( slot );
+		return;
+	}
+	// An empty box can't pass any event, so it goes nowhere.
+	for( auto x = range.mX0; x <= range.mX1; ++x ) {
+		for( auto y = range.mY0; y <= range.mY1; ++y )
+			mGrid->mCells[getCellKey( x, y )].push_back( slot );
+	}
+}
+
+void EventListenerTable::eraseFromGrid( uint32_t slot )
+{
+	auto erase = [slot]( vector<uint32_t> &slots ) {
+		auto found = std::find( slots.begin(), slots.end(), slot );
+		if( found != slots.end() )
+			slots.erase( found );
+	};
+	CellRange range;
+	if( ! getCellRange( slot, range ) ) {
+		erase( mGrid->mUnindexed );
+		return;
+	}
+	for( auto x = range.mX0; x <= range.mX1; ++x ) {
+		for( auto y = range.mY0; y <= range.mY1; ++y ) {
+			auto cell = mGrid->mCells.find( getCellKey( x, y ) );
+			if( cell == mGrid->mCells.end() )
+				continue;
+			erase( cell->second );
+			if( cell->second.empty() )
+				mGrid->mCells.erase( cell );
+		}
+	}
+}
+
+void EventListenerTable::rebuildGrid()
+{
+	mGrid->mCells.clear();
+	mGrid->mUnindexed.clear();
+	mGrid->mIsStale = false;
+	for( size_t slot = 0; slot < mListeners.size(); ++slot ) {
+		if( ! mListeners[slot].isRemoved() )
+			insertIntoGrid( static_cast<uint32_t>( slot ) );
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+// EventListenerTable::FilterColumns
+
+void EventListenerTable::FilterColumns::push( const FieldIndices &fields, const EventFilter &filter )
+{
+	auto slot = mFields[0].size();
+	resize( slot + 1 );
+	set( slot, fields, filter );
+}
+
+void EventListenerTable::FilterColumns::set( size_t slot, const FieldIndices &fields, const EventFilter &filter )
+{
+	mNumClauses = std::max( mNumClauses, filter.getNumClauses() );
+	for( size_t c = 0; c < EventFilter::kMaxClauses; ++c ) {
+		bool used = c < filter.getNumClauses();
+		mFields[c][slot] = fields[c];
+		mMins[c][slot] = used ? filter.getClause( c ).mMin : -numeric_limits<double>::infinity();
+		mMaxs[c][slot] = used ? filter.getClause( c ).mMax : numeric_limits<double>::infinity();
+	}
+}
+
+void EventListenerTable::FilterColumns::move( size_t from, size_t to )
+{
+	for( size_t c = 0; c < EventFilter::kMaxClauses; ++c ) {
+		mFields[c][to] = mFields[c][from];
+		mMins[c][to] = mMins[c][from];
+		mMaxs[c][to] = mMaxs[c][from];
+	}
+}
+
+void EventListenerTable::FilterColumns::resize( size_t size )
+{
+	for( size_t c = 0; c < EventFilter::kMaxClauses; ++c ) {
+		mFields[c].resize( size, 0 );
+		mMins[c].resize( size, -numeric_limits<double>::infinity() );
+		mMaxs[c].resize( size, numeric_limits<double>::infinity() );
+	}
+}
+
+void EventListenerTable::FilterColumns::permute( const vector<uint32_t> &order )
+{
+	for( size_t c = 0; c < EventFilter::kMaxClauses; ++c ) {
+		vector<uint8_t> fields( order.size() );
+		vector<double> mins( order.size() ), maxs( order.size() );
+		for( size_t i = 0; i < order.size(); ++i ) {
+			fields[i] = mFields[c][order[i]];
+			mins[i] = mMins[c][order[i]];
+			maxs[i] = mMaxs[c][order[i]];
+		}
+		mFields[c].swap( fields );
+		mMins[c].swap( mins );
+		mMaxs[c].swap( maxs );
+	}
+}
+
+uint64_t EventListenerTable::FilterColumns::evaluate( const double *values, size_t begin, size_t end ) const
+{
+	// Clause by clause, each slot's field value is gathered from the event's
+	// handful of values and tested against the slot's range. A missing field
+	// loads as NaN, which fails both comparisons.
+	const size_t count = end - begin;
+	uint64_t pass = count < 64 ? ( uint64_t( 1 ) << count ) - 1 : ~uint64_t( 0 );
+	for( size_t c = 0; c < mNumClauses && pass; ++c ) {
+		const uint8_t *fields = mFields[c].data() + begin;
+		const double *mins = mMins[c].data() + begin;
+		const double *maxs = mMaxs[c].data() + begin;
+		uint64_t clause = 0;
+		size_t i = 0;
+#if defined( __AVX2__ )
+		// The masked gather with a zeroed source avoids the unmasked form's
+		// uninitialized destination, which GCC warns about.
+		const __m256d allLanes = _mm256_castsi256_pd( _mm256_set1_epi64x( -1 ) );
+		for( ; i + 4 <= count; i += 4 ) {
+			int32_t packed;
+			memcpy( &packed, fields + i, sizeof( packed ) );
+			const __m128i indices = _mm_cvtepu8_epi32( _mm_cvtsi32_si128( packed ) );
+			const __m256d value = _mm256_mask_i32gather_pd( _mm256_setzero_pd(), values, indices, allLanes, 8 );
+			const __m256d inside = _mm256_and_pd( _mm256_cmp_pd( value, _mm256_loadu_pd( mins + i ), _CMP_GE_OQ ),
+												  _mm256_cmp_pd( value, _mm256_loadu_pd( maxs + i ), _CMP_LE_OQ ) );
+			clause |= uint64_t( _mm256_movemask_pd( inside ) ) << i;
+		}
+#elif defined( EVENT_MANAGER_FILTER_SSE2 )
+		for( ; i + 2 <= count; i += 2 ) {
+			const __m128d value = _mm_set_pd( values[fields[i + 1]], values[fields[i]] );
+			const __m128d inside = _mm_and_pd( _mm_cmpge_pd( value, _mm_loadu_pd( mins + i ) ),
+											   _mm_cmple_pd( value, _mm_loadu_pd( maxs + i ) ) );
+			clause |= uint64_t( _mm_movemask_pd( inside ) ) << i;
+		}
+#endif
+		for( ; i < count; ++i ) {
+			const double value = values[fields[i]];
+			clause |= uint64_t( ( value >= mins[i] ) & ( value <= maxs[i] ) ) << i;
+		}
+		pass &= clause;
+	}
+	return pass;
+}
+
+bool EventListenerTable::FilterColumns::passes( const double *values, size_t slot ) const
+{
+	for( size_t c = 0; c < mNumClauses; ++c ) {
+		const double value = values[mFields[c][slot]];
+		if( ! ( value >= mMins[c][slot] && value <= mMaxs[c][slot] ) )
+			return false;
+	}
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+// EventListenerRegistry
+
+EventListenerHandle EventListenerRegistry::add( const EventListener &listener, EventType type, const EventFilter &filter, EventKey key )
+{
+	auto &table = key == NO_EVENT_KEY ? getTable( type ) : mKeyedTables[type][key];
+	if( ! listener.isCallable() && table.contains( listener.getDelegate() ) ) {
+		CI_LOG_W( "Attempting to double-register a delegate" );
+		return EventListenerHandle();
+	}
+	EventListenerHandle handle( type, table.add( listener, filter ), key );
+	if( ! handle ) {
+		releaseIfEmpty( type, key );
+		return handle;
+	}
+	if( auto owner = listener.getOwner() )
+		mOwners[owner].push_back( handle );
+	return handle;
+}
+
+EventListenerTable& EventListenerRegistry::getTable( EventType type )
+{
+	auto found = mTables.find( type );
+	if( found != mTables.end() )
+		return found->second;
+	mChains.clear();
+	return mTables[type];
+}
+
+EventListenerTable* EventListenerRegistry::findTable( EventType type, EventKey key )
+{
+	if( key == NO_EVENT_KEY ) {
+		auto found = mTables.find( type );
+		return found != mTables.end() ? &found->second : nullptr;
+	}
+	auto keyedTables = mKeyedTables.find( type );
+	if( keyedTables == mKeyedTables.end() )
+		return nullptr;
+	auto found = keyedTables->second.find( key );
+	return found != keyedTables->second.end() ? &found->second : nullptr;
+}
+
+bool EventListenerRegistry::contains( EventType type, EventKey key )
+{
+	if( getChain( type ).mSize )
+		return true;
+	if( key == NO_EVENT_KEY )
+		return false;
+	auto keyedTables = mKeyedTables.find( type );
+	return keyedTables != mKeyedTables.end() && keyedTables->second.count( key );
+}
+
+void EventListenerRegistry::releaseIfEmpty( EventType type, EventKey key )
+{
+	// Keyed tables come and go with the keys, e.g. entities, so they're dropped
+	// once empty. Tables that are mid-dispatch are caught by dispatch() itself.
+	if( key == NO_EVENT_KEY )
+		return;
+	auto keyedTables = mKeyedTables.find( type );
+	if( keyedTables == mKeyedTables.end() )
+		return;
+	auto found = keyedTables->second.find( key );
+	if( found == keyedTables->second.end() || ! found->second.empty() || found->second.isDispatching() )
+		return;
+	keyedTables->second.erase( found );
+	if( keyedTables->second.empty() )
+		mKeyedTables.erase( keyedTables );
+}
+
+bool EventListenerRegistry::remove( const EventListenerHandle &handle )
+{
+	auto table = findTable( handle.getType(), handle.getKey() );
+	if( ! table )
+		return false;
+	auto listener = table->get( handle.getId() );
+	if( ! listener )
+		return false;
+	auto owner = listener->getOwner();
+	table->remove( handle.getId() );
+	if( owner )
+		removeOwned( owner, handle );
+	releaseIfEmpty( handle.getType(), handle.getKey() );
+	return true;
+}
+
+bool EventListenerRegistry::remove( const EventListenerDelegate &delegate, EventType type, EventKey key )
+{
+	auto table = findTable( type, key );
+	if( ! table )
+		return false;
+	auto id = table->getId( delegate );
+	return id && remove( EventListenerHandle( type, id, key ) );
+}
+
+bool EventListenerRegistry::rebind( const EventListenerHandle &handle, void *object )
+{
+	auto table = findTable( handle.getType(), handle.getKey() );
+	if( ! table )
+		return false;
+	auto listener = table->get( handle.getId() );
+	if( ! listener )
+		return false;
+	auto owner = listener->getOwner();
+	if( ! table->rebind( handle.getId(), object ) )
+		return false;
+	if( owner != object ) {
+		if( owner )
+			removeOwned( owner, handle );
+		if( object )
+			mOwners[object].push_back( handle );
+	}
+	return true;
+}
+
+bool EventListenerRegistry::setFilter( const EventListenerHandle &handle, const EventFilter &filter )
+{
+	auto table = findTable( handle.getType(), handle.getKey() );
+	return table && table->setFilter( handle.getId(), filter );
+}
+
+size_t EventListenerRegistry::removeAllFor( const void *owner )
+{
+	auto found = mOwners.find( owner );
+	if( found == mOwners.end() )
+		return 0;
+	auto handles = std::move( found->second );
+	mOwners.erase( found );
+
+	size_t removed = 0;
+	for( const auto &handle : handles ) {
+		auto table = findTable( handle.getType(), handle.getKey() );
+		if( table && table->remove( handle.getId() ) ) {
+			++removed;
+			releaseIfEmpty( handle.getType(), handle.getKey() );
+		}
+	}
+	return removed;
+}
+
+size_t EventListenerRegistry::removeExpired()
+{
+	// Keyed tables are swept by dispatch() right after they run instead, so
+	// this stays proportional to the number of event types.
+	size_t removed = 0;
+	for( auto &table : mTables )
+		removed += table.second.removeExpired();
+	return removed;
+}
+
+size_t EventListenerRegistry::removeExpired( EventType type )
+{
+	size_t removed = 0;
+	const auto &chain = getChain( type );
+	for( size_t i = 0; i < chain.mSize; ++i )
+		removed += chain.mTables[i]->removeExpired();
+	return removed;
+}
+
+const EventListenerRegistry::DispatchChain& EventListenerRegistry::getChain( EventType type )
+{
+	auto found = mChains.find( type );
+	if( found != mChains.end() )
+		return found->second;
+
+	DispatchChain chain;
+	auto current = type;
+	while( current != ANY_EVENT_TYPE && chain.mSize < kMaxTypeDepth - 1 ) {
+		auto table = mTables.find( current );
+		if( table != mTables.end() ) {
+			chain.mTables[chain.mSize] = &table->second;
+			chain.mTypes[chain.mSize++] = current;
+		}
+		current = getParent( current );
+	}
+	auto any = mTables.find( ANY_EVENT_TYPE );
+	if( any != mTables.end() ) {
+		chain.mTables[chain.mSize] = &any->second;
+		chain.mTypes[chain.mSize++] = ANY_EVENT_TYPE;
+	}
+	return mChains.emplace( type, chain ).first->second;
+}
+
+bool EventListenerRegistry::setParent( EventType type, EventType parent )
+{
+	if( type == ANY_EVENT_TYPE )
+		return false;
+	for( auto ancestor = parent; ancestor != ANY_EVENT_TYPE; ancestor = getParent( ancestor ) ) {
+		if( ancestor == type ) {
+			CI_LOG_E( "Event type parent would create a cycle" );
+			return false;
+		}
+	}
+	if( parent == ANY_EVENT_TYPE )
+		mParents.erase( type );
+	else
+		mParents[type] = parent;
+	mChains.clear();
+	return true;
+}
+
+EventType EventListenerRegistry::getParent( EventType type ) const
+{
+	auto found = mParents.find( type );
+	return found != mParents.end() ? found->second : ANY_EVENT_TYPE;
+}
+
+void EventListenerRegistry::setSpatialIndex( EventType type, uint32_t xField, uint32_t yField, double cellSize )
+{
+	getTable( type ).setSpatialIndex( xField, yField, cellSize );
+}
+
+bool EventListenerRegistry::defragmentNext( bool sortByTarget )
+{
+	// Keyed tables are small and compact themselves as they empty, so only the
+	// per-type tables take part.
+	auto table = mTables.upper_bound( mDefragmentCursor );
+	for( size_t i = 0; i < mTables.size(); ++i, ++table ) {
+		if( table == mTables.end() )
+			table = mTables.begin();
+		if( table->second.needsDefragment( sortByTarget ) ) {
+			table->second.defragment( sortByTarget );
+			mDefragmentCursor = table->first;
+			return true;
+		}
+	}
+	return false;
+}
+
+EventListenerStats EventListenerRegistry::getStats() const
+{
+	EventListenerStats stats;
+	for( const auto &table : mTables )
+		table.second.addStats( stats );
+	for( const auto &keyedTables : mKeyedTables ) {
+		for( const auto &table : keyedTables.second )
+			table.second.addStats( stats );
+	}
+	return stats;
+}
+
+void EventListenerRegistry::removeOwned( const void *owner, const EventListenerHandle &handle )
+{
+	if( ! owner )
+		return;
+	auto found = mOwners.find( owner );
+	if( found == mOwners.end() )
+		return;
+	auto &handles = found->second;
+	auto handleIt = std::find( handles.begin(), handles.end(), handle );
+	if( handleIt != handles.end() ) {
+		*handleIt = handles.back();
+		handles.pop_back();
+	}
+	if( handles.empty() )
+		mOwners.erase( found );
+}
+
+void EventListenerRegistry::clear()
+{
+	mTables.clear();
+	mKeyedTables.clear();
+	mOwners.clear();
+	mChains.clear();
+}
@@ -0,0 +1,623 @@
+//
+//  EventListenerTable.h
+//  Cinder-EventManager
+//
+//
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined( _MSC_VER )
+#include <intrin.h>
+#endif
+
+#include "BaseEventData.h"
+#include "Delegate.h"
+#include "EventFilter.h"
+
+using EventListenerDelegate = Delegate<void( EventDataRef )>;
+
+//! Identifies one registration in an EventManager. Returned by addListener()
+//! for callables, which have no other identity to remove them by.
+class EventListenerHandle {
+public:
+	EventListenerHandle() : mType( 0 ), mId( 0 ), mKey( NO_EVENT_KEY ) {}
+	EventListenerHandle( EventType type, uint64_t id, EventKey key = NO_EVENT_KEY ) : mType( type ), mId( id ), mKey( key ) {}
+
+	EventType	getType() const { return mType; }
+	uint64_t	getId() const { return mId; }
+	//! The subscription key, or NO_EVENT_KEY for listeners of the whole type.
+	EventKey	getKey() const { return mKey; }
+
+	explicit operator bool() const { return mId != 0; }
+	bool operator==( const EventListenerHandle &other ) const { return mType == other.mType && mId == other.mId && mKey == other.mKey; }
+	bool operator!=( const EventListenerHandle &other ) const { return ! ( *this == other ); }
+
+private:
+	EventType	mType;
+	uint64_t	mId;
+	EventKey	mKey;
+};
+
+//! Process-wide free lists for listener callables that are too large, or not
+//! trivially copyable enough, to live inline in their listener slot. Blocks are
+//! carved from chunks and recycled, so churn doesn't hit the global heap.
+class EventListenerPool {
+public:
+	static const size_t kMaxBlockSize = 256;
+
+	static EventListenerPool& get();
+
+	//! Returns storage for \a size bytes aligned to std::max_align_t. Sizes over
+	//! kMaxBlockSize fall through to the global heap.
+	void*	allocate( size_t size );
+	void	deallocate( void *block, size_t size );
+
+private:
+	EventListenerPool();
+
+	struct FreeBlock { FreeBlock *mNext; };
+	static const size_t kNumSizeClasses = 3;
+	static const size_t kBlocksPerChunk = 32;
+
+	static size_t getSizeClass( size_t size );
+
+	std::mutex									mMutex;
+	std::array<FreeBlock*, kNumSizeClasses>		mFreeLists;
+	std::vector<std::unique_ptr<unsigned char[]>>	mChunks;
+};
+
+//! One listener slot. A slot either calls a plain delegate or owns a callable,
+//! such as a capturing lambda. Trivially copyable callables of up to
+//! kInlineStorageSize bytes are stored inside the slot itself, so registering
+//! them never allocates; anything else is placed in the EventListenerPool.
+//! Slots are trivially copyable so listener arrays can be moved with memcpy;
+//! the owning EventListenerTable releases pooled callables explicitly.
+class EventListener {
+public:
+	static const size_t kInlineStorageSize = 32;
+
+	EventListener() : mDestroy( nullptr ), mId( 0 ), mFlags( 0 ), mWeakThunk( nullptr ) {}
+	explicit EventListener( const EventListenerDelegate &delegate ) : mDelegate( delegate ), mDestroy( nullptr ), mId( 0 ), mFlags( 0 ), mWeakThunk( nullptr ) {}
+	//! Delegates of any value category take the constructor above, so they're
+	//! indexed and owned like any other delegate rather than wrapped as callables.
+	template<typename Callable, typename = typename std::enable_if<
+		! std::is_same<typename std::decay<Callable>::type, EventListener>::value &&
+		! std::is_same<typename std::decay<Callable>::type, EventListenerDelegate>::value>::type>
+	explicit EventListener( Callable &&callable );
+
+	//! A listener that calls \a Method on \a object for as long as it is alive.
+	//! Once \a object has expired the listener stops being called, and its
+	//! table drops it on the manager's next update().
+	template<typename T, void (T::*Method)( EventDataRef )>
+	static EventListener weak( const std::weak_ptr<T> &object );
+
+	void invoke( const EventDataRef &event )
+	{
+		if( mFlags & INLINE_CALLABLE )
+			mDelegate.getThunk()( mStorage, event );
+		else if( mFlags & WEAK ) {
+			if( ! mWeakThunk( mDelegate.getObject(), event ) )
+				mFlags |= EXPIRED;
+		}
+		else
+			mDelegate( event );
+	}
+
+	//! The bound delegate. For callables this points at their storage.
+	const EventListenerDelegate&	getDelegate() const { return mDelegate; }
+	//! True for listeners registered as a callable rather than a delegate.
+	bool		isCallable() const { return ( mFlags & ( INLINE_CALLABLE | POOLED_CALLABLE ) ) != 0; }
+	//! The object a delegate listener is bound to, or nullptr for callables and
+	//! free functions.
+	const void*	getOwner() const { return isCallable() ? nullptr : mDelegate.getObject(); }
+	bool		isRemoved() const { return ( mFlags & REMOVED ) != 0; }
+	//! Makes the listener one-shot: its table removes it as it's called, so
+	//! it hears at most one event.
+	void		setOnce() { mFlags |= ONCE; }
+	bool		isOnce() const { return ( mFlags & ONCE ) != 0; }
+	//! True for weak listeners whose object was found expired during dispatch.
+	bool		isExpired() const { return ( mFlags & EXPIRED ) != 0; }
+	uint64_t	getId() const { return mId; }
+
+private:
+	friend class EventListenerTable;
+
+	enum Flags : uint32_t { INLINE_CALLABLE = 1 << 0, POOLED_CALLABLE = 1 << 1, REMOVED = 1 << 2, WEAK = 1 << 3, EXPIRED = 1 << 4, ONCE = 1 << 5 };
+
+	template<typename T, void (T::*Method)( EventDataRef )>
+	struct WeakCallable {
+		//! Returns false, without calling, once the object has expired.
+		static bool invoke( void *callable, EventDataRef event )
+		{
+			auto object = static_cast<WeakCallable*>( callable )->mObject.lock();
+			if( ! object )
+				return false;
+			( object.get()->*Method )( std::move( event ) );
+			return true;
+		}
+		std::weak_ptr<T> mObject;
+	};
+
+	template<typename CallableType, typename Callable>
+	void store( Callable &&callable, std::true_type fitsInline );
+	template<typename CallableType, typename Callable>
+	void store( Callable &&callable, std::false_type fitsInline );
+	template<typename Callable>
+	static void callableThunk( void *callable, EventDataRef event ) { ( *static_cast<Callable*>( callable ) )( std::move( event ) ); }
+	template<typename Callable>
+	static void destroyPooled( void *callable )
+	{
+		static_cast<Callable*>( callable )->~Callable();
+		EventListenerPool::get().deallocate( callable, sizeof( Callable ) );
+	}
+
+	//! Frees a pooled callable. Called exactly once, by the owning table.
+	void release()
+	{
+		if( mDestroy )
+			mDestroy( mDelegate.getObject() );
+		mDestroy = nullptr;
+	}
+
+	EventListenerDelegate	mDelegate;
+	void					(*mDestroy)( void *callable );
+	uint64_t				mId;
+	uint32_t				mFlags;
+	//! Set for weak listeners only. Fits in the padding before mStorage.
+	bool					(*mWeakThunk)( void *callable, EventDataRef event );
+	alignas( std::max_align_t ) unsigned char mStorage[kInlineStorageSize];
+};
+
+static_assert( std::is_trivially_copyable<EventListener>::value, "EventListener slots must stay trivially copyable" );
+
+template<typename Callable, typename>
+EventListener::EventListener( Callable &&callable )
+: mDestroy( nullptr ), mId( 0 ), mFlags( 0 ), mWeakThunk( nullptr )
+{
+	using CallableType = typename std::decay<Callable>::type;
+	static_assert( alignof( CallableType ) <= alignof( std::max_align_t ), "Over-aligned listener callables are not supported" );
+
+	using FitsInline = std::integral_constant<bool, sizeof( CallableType ) <= kInlineStorageSize
+		&& std::is_trivially_copyable<CallableType>::value
+		&& std::is_trivially_destructible<CallableType>::value>;
+	store<CallableType>( std::forward<Callable>( callable ), FitsInline() );
+}
+
+template<typename CallableType, typename Callable>
+void EventListener::store( Callable &&callable, std::true_type /*fitsInline*/ )
+{
+	new( mStorage ) CallableType( std::forward<Callable>( callable ) );
+	mDelegate = EventListenerDelegate( nullptr, &callableThunk<CallableType> );
+	mFlags = INLINE_CALLABLE;
+}
+
+template<typename CallableType, typename Callable>
+void EventListener::store( Callable &&callable, std::false_type /*fitsInline*/ )
+{
+	void *storage = EventListenerPool::get().allocate( sizeof( CallableType ) );
+	new( storage ) CallableType( std::forward<Callable>( callable ) );
+	mDelegate = EventListenerDelegate( storage, &callableThunk<CallableType> );
+	mDestroy = &destroyPooled<CallableType>;
+	mFlags = POOLED_CALLABLE;
+}
+
+template<typename T, void (T::*Method)( EventDataRef )>
+EventListener EventListener::weak( const std::weak_ptr<T> &object )
+{
+	// The weak_ptr isn't trivially copyable, so it always lives in the pool.
+	using Callable = WeakCallable<T, Method>;
+	EventListener listener;
+	void *storage = EventListenerPool::get().allocate( sizeof( Callable ) );
+	new( storage ) Callable{ object };
+	listener.mDelegate = EventListenerDelegate( storage, nullptr );
+	listener.mDestroy = &destroyPooled<Callable>;
+	listener.mWeakThunk = &Callable::invoke;
+	listener.mFlags = POOLED_CALLABLE | WEAK;
+	return listener;
+}
+
+//! Slot usage of one or more listener tables.
+struct EventListenerStats {
+	size_t	mNumTables = 0;
+	//! Live listeners.
+	size_t	mNumListeners = 0;
+	//! Removed slots still taking up room in the arrays.
+	size_t	mNumHoles = 0;
+	//! Allocated slots, live or not.
+	size_t	mCapacity = 0;
+	//! Tables whose listeners aren't in target address order.
+	size_t	mNumUnsortedTables = 0;
+
+	//! Fraction of allocated slots not holding a live listener.
+	double	getFragmentation() const { return mCapacity ? 1.0 - double( mNumListeners ) / double( mCapacity ) : 0.0; }
+};
+
+//! The listeners registered for one event type, stored contiguously in
+//! registration order. Delegate listeners are also indexed by their hash.
+//! Removal only marks a slot; removed slots are skipped by dispatch and packed
+//! away once no dispatch is in progress. Listeners added from inside a dispatch
+//! are held back until it finishes, so the array never moves under a running
+//! listener. One-shot listeners are retired by dispatch itself, just before
+//! they're called, which costs the same as any other removal.
+//!
+//! Listener filters are kept in parallel columns, one entry per slot, so
+//! dispatch can test a block of them in a tight loop before calling any.
+//! A table may also index its listeners' filters in a uniform grid over two
+//! fields, such as an event's position, so dispatch only tests the listeners
+//! whose filter box covers the event's cell.
+class EventListenerTable {
+public:
+	//! Distinct filter fields a single table may test.
+	static const size_t kMaxFilterFields = 15;
+	//! Grid cells a listener's box may cover before it's left out of the grid
+	//! and tested for every event instead.
+	static const size_t kMaxGridCellsPerListener = 64;
+
+	EventListenerTable() : mNumLive( 0 ), mNumRemoved( 0 ), mDispatchDepth( 0 ), mHasExpired( false ), mIsSorted( true ), mHasFilters( false ) {}
+	~EventListenerTable();
+
+	EventListenerTable( const EventListenerTable & ) = delete;
+	EventListenerTable& operator=( const EventListenerTable & ) = delete;
+
+	//! Takes ownership of \a listener and returns its id. The listener is only
+	//! called for events that pass \a filter. Returns 0, without taking
+	//! ownership, if \a filter is invalid or would take the table past
+	//! kMaxFilterFields.
+	uint64_t	add( const EventListener &listener, const EventFilter &filter = EventFilter() );
+	bool		remove( uint64_t id );
+	//! Removes the delegate listener bound to \a delegate.
+	bool		remove( const EventListenerDelegate &delegate );
+	bool		contains( const EventListenerDelegate &delegate ) const;
+	//! Returns the id of the delegate listener bound to \a delegate, or 0.
+	uint64_t	getId( const EventListenerDelegate &delegate ) const;
+	//! Returns the live listener with \a id, or nullptr.
+	const EventListener* get( uint64_t id ) const;
+	//! Points the delegate listener \a id at \a object, keeping its slot, id and
+	//! bound function. Fails for callables, or if \a object is already bound to
+	//! the same function in this table.
+	bool		rebind( uint64_t id, void *object );
+	//! Replaces the filter of listener \a id, e.g. as the region it covers
+	//! moves. Fails if \a filter is invalid or would take the table past
+	//! kMaxFilterFields.
+	bool		setFilter( uint64_t id, const EventFilter &filter );
+	void		clear();
+	//! Removes weak listeners whose objects were found expired while
+	//! dispatching. Cheap when none were. Returns how many were removed.
+	size_t		removeExpired();
+
+	//! True if defragment() has anything to do and may run now.
+	bool		needsDefragment( bool sortByTarget ) const;
+	//! Packs live listeners together, trims excess capacity and, if
+	//! \a sortByTarget, orders them by the address of the object each one
+	//! calls, so dispatch walks memory forwards. Sorting gives up
+	//! registration order. Does nothing while a dispatch is in progress.
+	void		defragment( bool sortByTarget );
+	void		addStats( EventListenerStats &stats ) const;
+
+	//! Buckets listeners whose filter has a finite range on both \a xField and
+	//! \a yField into square cells of \a cellSize. Events then only reach the
+	//! listeners of the cell they fall in, plus those the grid couldn't index.
+	//! Listeners are then no longer called in registration order. A
+	//! \a cellSize of 0 removes the grid. Must not be called while dispatching.
+	void		setSpatialIndex( uint32_t xField, uint32_t yField, double cellSize );
+	bool		hasSpatialIndex() const { return static_cast<bool>( mGrid ); }
+
+	size_t		size() const { return mNumLive; }
+	bool		empty() const { return mNumLive == 0; }
+	bool		isDispatching() const { return mDispatchDepth > 0; }
+
+	//! Calls \a fn( EventListener& ) for every live listener whose filter
+	//! passes \a event, in registration order unless the table is sorted or
+	//! has a spatial index. Returns true if any listener was visited.
+	template<typename Fn>
+	bool dispatch( const EventData &event, Fn &&fn );
+
+private:
+	struct Handle {
+		uint32_t mSlot;
+		uint32_t mGeneration;
+	};
+	static const uint32_t kPendingSlot = 0x80000000u;
+	static const uint32_t kFreeSlot = 0xffffffffu;
+
+	//! One bit of an evaluate() mask per slot.
+	static const size_t kFilterBlockSize = 64;
+
+	//! One column per clause and property. Unused clauses test the constant
+	//! value slot 0 against an unbounded range, so every clause is evaluated
+	//! without branching. Only the clauses some filter in the table has used
+	//! are evaluated at all.
+	struct FilterColumns {
+		using FieldIndices = std::array<uint8_t, EventFilter::kMaxClauses>;
+
+		void push( const FieldIndices &fields, const EventFilter &filter );
+		void set( size_t slot, const FieldIndices &fields, const EventFilter &filter );
+		void move( size_t from, size_t to );
+		void resize( size_t size );
+		void permute( const std::vector<uint32_t> &order );
+		//! Returns a mask with bit i set if the filter of slot \a begin + i
+		//! passes, given the event's field \a values. [\a begin, \a end) spans
+		//! at most kFilterBlockSize slots. Uses AVX2 or SSE2 where available.
+		uint64_t evaluate( const double *values, size_t begin, size_t end ) const;
+		//! Single slot version of evaluate().
+		bool passes( const double *values, size_t slot ) const;
+
+		std::array<std::vector<uint8_t>, EventFilter::kMaxClauses>	mFields;
+		std::array<std::vector<double>, EventFilter::kMaxClauses>	mMins;
+		std::array<std::vector<double>, EventFilter::kMaxClauses>	mMaxs;
+		//! Most clauses any filter set so far has had.
+		size_t	mNumClauses = 0;
+	};
+
+	//! Cells are keyed by their packed integer coordinates. Slots of removed
+	//! listeners linger until the next compaction, which rebuilds the grid.
+	struct SpatialGrid {
+		uint32_t	mXField;
+		uint32_t	mYField;
+		double		mInvCellSize;
+		std::unordered_map<uint64_t, std::vector<uint32_t>>	mCells;
+		//! Slots without a box on both fields, or with too large a box.
+		std::vector<uint32_t>	mUnindexed;
+		//! Set when a filter changed mid-dispatch; rebuilt once it ends.
+		bool		mIsStale = false;
+	};
+	struct CellRange {
+		int64_t mX0, mY0, mX1, mY1;
+	};
+
+	struct DispatchScope {
+		explicit DispatchScope( EventListenerTable *table ) : mTable( table ) { ++mTable->mDispatchDepth; }
+		~DispatchScope() { if( --mTable->mDispatchDepth == 0 ) mTable->endDispatch(); }
+		EventListenerTable *mTable;
+	};
+
+	static uint32_t	getHandleIndex( uint64_t id ) { return static_cast<uint32_t>( id & 0xffffffffu ) - 1; }
+	EventListener*	find( uint64_t id );
+	void			removeAt( EventListener &listener, uint32_t index );
+	void			endDispatch();
+	void			compactIfSparse();
+	void			compact();
+	void			append( const EventListener &listener, const EventFilter &filter );
+	//! Registers the fields \a filter tests. Fails past kMaxFilterFields.
+	bool			addFilterFields( const EventFilter &filter );
+	FilterColumns::FieldIndices getFilterFieldIndices( const EventFilter &filter ) const;
+	//! Fills \a values with slot 0 followed by \a event's value for each field.
+	//! The rest are NaN, so a field a listener adds mid-dispatch fails its
+	//! clauses until the next dispatch loads it.
+	void			loadFilterValues( const EventData &event, double *values ) const;
+	static const void* getTarget( const EventListener &listener ) { return listener.mDelegate.getObject(); }
+	//! \a bits must not be 0.
+	static size_t	countTrailingZeros( uint64_t bits )
+	{
+#if defined( _MSC_VER )
+		unsigned long index;
+		_BitScanForward64( &index, bits );
+		return index;
+#else
+		return static_cast<size_t>( __builtin_ctzll( bits ) );
+#endif
+	}
+	//! Returns false if \a slot's filter doesn't bound both grid fields to
+	//! at most kMaxGridCellsPerListener cells.
+	bool			getCellRange( size_t slot, CellRange &range ) const;
+	bool			getCell( double value, int64_t &cell ) const;
+	static uint64_t	getCellKey( int64_t x, int64_t y ) { return ( uint64_t( uint32_t( x ) ) << 32 ) | uint32_t( y ); }
+	const std::vector<uint32_t>* findCell( const EventData &event ) const;
+	void			insertIntoGrid( uint32_t slot );
+	void			eraseFromGrid( uint32_t slot );
+	void			rebuildGrid();
+
+	std::vector<EventListener>	mListeners;
+	std::vector<EventListener>	mPending;
+	std::vector<EventFilter>	mPendingFilters;
+	//! Parallel to mListeners once any listener has a filter.
+	FilterColumns				mFilterColumns;
+	std::vector<uint32_t>		mFilterFieldIds;
+	std::unique_ptr<SpatialGrid> mGrid;
+	std::vector<Handle>			mHandles;
+	std::vector<uint32_t>		mFreeHandles;
+	//! Ids of the live delegate listeners, so duplicate checks and removal by
+	//! delegate don't scan the table.
+	std::unordered_map<EventListenerDelegate, uint64_t>	mDelegateIds;
+	size_t						mNumLive;
+	size_t						mNumRemoved;
+	int							mDispatchDepth;
+	bool						mHasExpired;
+	//! Whether mListeners is in getTarget() order.
+	bool						mIsSorted;
+	bool						mHasFilters;
+};
+
+template<typename Fn>
+bool EventListenerTable::dispatch( const EventData &event, Fn &&fn )
+{
+	DispatchScope scope( this );
+	bool dispatched = false;
+	auto visit = [&]( EventListener &listener ) {
+		if( listener.mFlags & ( EventListener::REMOVED | EventListener::EXPIRED ) )
+			return;
+		// Retired first, so the listener can't be reached again by an event it
+		// triggers itself. Its slot lives on until the dispatch ends.
+		if( listener.mFlags & EventListener::ONCE )
+			removeAt( listener, getHandleIndex( listener.mId ) );
+		fn( listener );
+		mHasExpired |= listener.isExpired();
+		dispatched = true;
+	};
+	
+	// Listeners added during dispatch go to mPending, so neither the size nor
+	// the storage of mListeners, or of the filter columns, can change under
+	// these loops. Neither can the grid's cells, which are only rebuilt once
+	// dispatch ends.
+	if( mGrid ) {
+		double values[kMaxFilterFields + 1];
+		loadFilterValues( event, values );
+		for( auto slot : mGrid->mUnindexed ) {
+			if( mFilterColumns.passes( values, slot ) )
+				visit( mListeners[slot] );
+		}
+		if( auto cell = findCell( event ) ) {
+			for( auto slot : *cell ) {
+				if( mFilterColumns.passes( values, slot ) )
+					visit( mListeners[slot] );
+			}
+		}
+		return dispatched;
+	}
+
+	const size_t count = mListeners.size();
+	if( ! mHasFilters ) {
+		for( size_t i = 0; i < count; ++i )
+			visit( mListeners[i] );
+		return dispatched;
+	}
+	
+	double values[kMaxFilterFields + 1];
+	loadFilterValues( event, values );
+	for( size_t begin = 0; begin < count; begin += kFilterBlockSize ) {
+		const size_t end = std::min( count, begin + kFilterBlockSize );
+		// Walk the set bits so only the hits cost anything.
+		for( uint64_t pass = mFilterColumns.evaluate( values, begin, end ); pass; pass &= pass - 1 )
+			visit( mListeners[begin + countTrailingZeros( pass )] );
+	}
+	return dispatched;
+}
+
+//! All of an EventManager's listener tables, one per event type, plus an index
+//! from each delegate's bound object to its registrations across every type.
+//! The index lets an object drop all of its subscriptions in time proportional
+//! to its own subscription count rather than to the total number of listeners.
+//! Listeners subscribed to a single key of a type, such as an entity id, live
+//! in a per-type hash map of tables by key, so an event only reaches the
+//! listeners of its own key.
+//!
+//! Event types may be given a parent type, so listeners of the parent receive
+//! the events of all its descendants, and listeners of ANY_EVENT_TYPE receive
+//! every event. Each dispatched type caches the flattened list of tables along
+//! its ancestry, which is rebuilt only after a table is created or the
+//! hierarchy changes, so dispatch never walks the hierarchy itself.
+class EventListenerRegistry {
+	using TableMap = std::map<EventType, EventListenerTable>;
+	using KeyedTableMap = std::unordered_map<EventKey, EventListenerTable>;
+
+public:
+	using iterator = TableMap::iterator;
+
+	//! Most tables an event is dispatched to, counting its own type's table
+	//! and ANY_EVENT_TYPE's. Ancestors beyond that are ignored.
+	static const size_t kMaxTypeDepth = 8;
+
+	iterator			find( EventType type ) { return mTables.find( type ); }
+	iterator			end() { return mTables.end(); }
+
+	//! Returns an empty handle if \a listener is a delegate that is already
+	//! registered for \a type and \a key, or if \a filter can't be added to
+	//! its table.
+	EventListenerHandle	add( const EventListener &listener, EventType type, const EventFilter &filter = EventFilter(), EventKey key = NO_EVENT_KEY );
+	//! True if any table could receive an event of \a type and \a key.
+	bool				contains( EventType type, EventKey key );
+	bool				remove( const EventListenerHandle &handle );
+	bool				remove( const EventListenerDelegate &delegate, EventType type, EventKey key = NO_EVENT_KEY );
+	bool				rebind( const EventListenerHandle &handle, void *object );
+	bool				setFilter( const EventListenerHandle &handle, const EventFilter &filter );
+	//! Removes every delegate listener bound to \a owner. Returns how many
+	//! listeners were removed.
+	size_t				removeAllFor( const void *owner );
+	//! Runs EventListenerTable::removeExpired() on every per-type table.
+	size_t				removeExpired();
+	//! Sweeps the tables an event of \a type is dispatched to.
+	size_t				removeExpired( EventType type );
+	//! Defragments the next table that needs it, round robin across calls.
+	//! Returns false if no table needed it.
+	bool				defragmentNext( bool sortByTarget );
+	EventListenerStats	getStats() const;
+	//! Removes every listener. The type hierarchy is kept.
+	void				clear();
+
+	//! Makes \a parent's listeners receive the events of \a type and of all its
+	//! descendants. A \a parent of ANY_EVENT_TYPE detaches \a type. Returns
+	//! false if that would create a cycle.
+	bool				setParent( EventType type, EventType parent );
+	//! Returns \a type's parent, or ANY_EVENT_TYPE if it has none.
+	EventType			getParent( EventType type ) const;
+	//! See EventListenerTable::setSpatialIndex(). Applies to \a type's own
+	//! table; keyed listeners are already routed by key.
+	void				setSpatialIndex( EventType type, uint32_t xField, uint32_t yField, double cellSize );
+
+	//! Calls \a fn( EventListener& ) for the listeners of \a event's type, of
+	//! each of its ancestors and then for those of its key. Returns true if any listener was visited.
+	template<typename Fn>
+	bool				dispatch( const EventData &event, Fn &&fn );
+
+private:
+	//! The per-type tables an event of one type is dispatched to, most derived
+	//! first. Table addresses are stable until clear().
+	struct DispatchChain {
+		std::array<EventListenerTable*, kMaxTypeDepth>	mTables;
+		std::array<EventType, kMaxTypeDepth>			mTypes;
+		size_t											mSize = 0;
+	};
+
+	const DispatchChain&	getChain( EventType type );
+	//! Returns \a type's table, creating it if needed.
+	EventListenerTable&		getTable( EventType type );
+	EventListenerTable*		findTable( EventType type, EventKey key );
+	void					releaseIfEmpty( EventType type, EventKey key );
+	void					removeOwned( const void *owner, const EventListenerHandle &handle );
+
+	TableMap	mTables;
+	std::unordered_map<EventType, KeyedTableMap>	mKeyedTables;
+	EventType	mDefragmentCursor = 0;
+	std::unordered_map<const void*, std::vector<EventListenerHandle>> mOwners;
+	std::unordered_map<EventType, EventType>		mParents;
+	//! Emptied whenever a per-type table is created or the hierarchy changes.
+	std::unordered_map<EventType, DispatchChain>	mChains;
+};
+
+template<typename Fn>
+bool EventListenerRegistry::dispatch( const EventData &event, Fn &&fn )
+{
+	bool dispatched = false;
+	const auto type = event.getEventType();
+	// Copied, since listeners that subscribe to new types empty the cache.
+	const DispatchChain chain = getChain( type );
+	for( size_t i = 0; i < chain.mSize; ++i ) {
+		const auto tableType = chain.mTypes[i];
+		dispatched |= chain.mTables[i]->dispatch( event, [&]( EventListener &listener ) {
+			// The table has already retired a one-shot listener; only the
+			// owner index is left to update.
+			if( listener.isOnce() )
+				removeOwned( listener.getOwner(), EventListenerHandle( tableType, listener.getId() ) );
+			fn( listener );
+		} );
+	}
+
+	const auto key = event.getEventKey();
+	if( key == NO_EVENT_KEY )
+		return dispatched;
+	// Listeners may add keyed tables while this one runs, so hold on to the
+	// table itself rather than to iterators.
+	if( auto table = findTable( type, key ) ) {
+		dispatched |= table->dispatch( event, [&]( EventListener &listener ) {
+			if( listener.isOnce() )
+				removeOwned( listener.getOwner(), EventListenerHandle( type, listener.getId(), key ) );
+			fn( listener );
+		} );
+		table->removeExpired();
+		releaseIfEmpty( type, key );
+	}
+	return dispatched;
+}
@@ -0,0 +1,160 @@
+//
+//  EventMailbox.h
+//  Cinder-EventManager
+//
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "BaseEventData.h"
+
+//! Multi-producer, single-consumer inbox of events. Any thread may push()
+//! without taking a lock; the owning thread takes everything pushed so far
+//! with one drain(), oldest first. Producers only ever swing the head of a
+//! linked list, and the consumer detaches the whole list at once, so there
+//! is no ABA hazard to guard against. List nodes are recycled through a
+//! process-wide pool, so once warmed up pushing doesn't allocate.
+class EventMailbox {
+public:
+	EventMailbox() : mHead( nullptr ) {}
+	~EventMailbox() { drain( []( EventDataRef && ) {} ); }
+
+	EventMailbox( const EventMailbox & ) = delete;
+	EventMailbox& operator=( const EventMailbox & ) = delete;
+
+	//! Thread Safe. Returns true if the mailbox was empty, so the caller knows
+	//! the consumer may need waking.
+	bool push( const EventDataRef &event )
+	{
+		// Once published the node belongs to the consumer, so only the local
+		// copy of the old head may be looked at afterwards.
+		auto head = mHead.load( std::memory_order_relaxed );
+		auto node = NodePool::get().acquire();
+		node->mEvent = event;
+		node->mNext = head;
+		while( ! mHead.compare_exchange_weak( head, node, std::memory_order_release, std::memory_order_relaxed ) )
+			node->mNext = head;
+		return head == nullptr;
+	}
+
+	//! Calls \a fn( EventDataRef&& ) for every event pushed so far, in push
+	//! order. Only the owning thread may drain. Returns how many were taken.
+	template<typename Fn>
+	size_t drain( Fn &&fn )
+	{
+		// The list comes off newest first, so reverse it to keep FIFO order.
+		Node *reversed = nullptr;
+		for( auto node = mHead.exchange( nullptr, std::memory_order_acquire ); node; ) {
+			auto next = node->mNext;
+			node->mNext = reversed;
+			reversed = node;
+			node = next;
+		}
+		if( ! reversed )
+			return 0;
+		// The list stays linked as it's walked, so it goes back to the pool in
+		// one piece.
+		size_t count = 0;
+		Node *last = nullptr;
+		for( auto node = reversed; node; node = node->mNext ) {
+			fn( std::move( node->mEvent ) );
+			node->mEvent.reset();
+			last = node;
+			++count;
+		}
+		NodePool::get().release( reversed, last );
+		return count;
+	}
+
+	bool empty() const { return mHead.load( std::memory_order_acquire ) == nullptr; }
+
+private:
+	struct Node {
+		EventDataRef	mEvent;
+		Node			*mNext = nullptr;
+	};
+
+	//! Mailbox nodes shared by every mailbox. Each producer thread takes nodes
+	//! from its own cache without synchronizing, and refills it with every
+	//! node drained since, taken in one exchange, or else with a new chunk.
+	//! Drains hand their nodes back in one push. Nothing pops single nodes off
+	//! the shared list, so it has no ABA hazard either.
+	class NodePool {
+	public:
+		static const size_t kNodesPerChunk = 64;
+
+		static NodePool& get()
+		{
+			// Intentionally leaked, like EventListenerPool, so caches and
+			// mailboxes torn down during static destruction can still return
+			// their nodes.
+			static NodePool *sPool = new NodePool;
+			return *sPool;
+		}
+
+		Node* acquire()
+		{
+			auto &cache = getCache();
+			if( ! cache.mHead )
+				cache.mHead = mReleased.exchange( nullptr, std::memory_order_acquire );
+			if( ! cache.mHead )
+				cache.mHead = allocateChunk();
+			auto node = cache.mHead;
+			cache.mHead = node->mNext;
+			return node;
+		}
+		//! Takes back the nodes from \a first to \a last, linked through mNext.
+		void release( Node *first, Node *last )
+		{
+			auto head = mReleased.load( std::memory_order_relaxed );
+			do {
+				last->mNext = head;
+			} while( ! mReleased.compare_exchange_weak( head, first, std::memory_order_release, std::memory_order_relaxed ) );
+		}
+
+	private:
+		NodePool() : mReleased( nullptr ) {}
+
+		//! A producer thread's nodes, returned to the pool when the thread ends.
+		struct Cache {
+			~Cache()
+			{
+				if( ! mHead )
+					return;
+				auto last = mHead;
+				while( last->mNext )
+					last = last->mNext;
+				NodePool::get().release( mHead, last );
+			}
+			Node	*mHead = nullptr;
+		};
+
+		static Cache& getCache()
+		{
+			static thread_local Cache sCache;
+			return sCache;
+		}
+
+		Node* allocateChunk()
+		{
+			std::lock_guard<std::mutex> lock( mMutex );
+			mChunks.emplace_back( new Node[kNodesPerChunk] );
+			auto chunk = mChunks.back().get();
+			for( size_t i = 0; i + 1 < kNodesPerChunk; ++i )
+				chunk[i].mNext = &chunk[i + 1];
+			return chunk;
+		}
+
+		std::atomic<Node*>						mReleased;
+		std::mutex								mMutex;
+		std::vector<std::unique_ptr<Node[]>>	mChunks;
+	};
+
+	std::atomic<Node*>	mHead;
+};
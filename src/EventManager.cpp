@@ -37,17 +37,67 @@
 //========================================================================
 
 #include "EventManager.h"
-#include "cinder/Log.h"
-#include "cinder/app/App.h"
+#include "EventTrace.h"
+
+#include <algorithm>
+#include <chrono>
+
+#if defined( __linux__ )
+	#include <cerrno>
+	#include <sys/eventfd.h>
+	#include <unistd.h>
+#endif
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || defined( _M_IX86 )
+	#include <immintrin.h>
+#endif
 
 //#define LOG_EVENT( stream )	CI_LOG_I( stream )
 #define LOG_EVENT( stream )	((void)0)
 
-using namespace ci;
+#if defined( EVENT_MANAGER_ENABLE_METRICS )
+	#include <algorithm>
+	#define METRICS_EVENT( expr )	expr
+	#define INVOKE_LISTENER( listener, event, type )	invokeTimed( mMetrics, listener, event, type )
+#else
+	#define METRICS_EVENT( expr )	((void)0)
+	#define INVOKE_LISTENER( listener, event, type )	listener.invoke( event )
+#endif
+
 using namespace std;
+
+namespace {
+	
+//! Tells the CPU it's in a spin loop, to save power and free up the sibling
+//! hyperthread.
+inline void cpuRelax()
+{
+#if defined( __SSE2__ ) || defined( _M_X64 ) || defined( _M_IX86 )
+	_mm_pause();
+#elif defined( __aarch64__ ) || defined( __arm__ )
+	__asm__ __volatile__( "yield" );
+#endif
+}
+	
+#if defined( EVENT_MANAGER_ENABLE_METRICS )
+
+// Listeners are identified by their registration id.
+inline void invokeTimed( EventMetrics &metrics, EventListener &listener, const EventDataRef &event, EventType type )
+{
+	auto start = chrono::steady_clock::now();
+	listener.invoke( event );
+	auto nanos = chrono::duration_cast<chrono::nanoseconds>( chrono::steady_clock::now() - start ).count();
+	metrics.recordListener( type, listener.getId(), static_cast<uint64_t>( nanos ) );
+}
+#endif
+	
+} // anonymous namespace
 	
 EventManager::EventManager( const std::string &name, bool setAsGlobal )
-: EventManagerBase( name, setAsGlobal ), mActiveQueue( 0 )
+: EventManagerBase( name, setAsGlobal ), mActiveQueue( 0 ), mDefragmentBudgetMicros( 100 ),
+	mSortListenersByTarget( false ), mOwnerThread( std::this_thread::get_id() ), mWaitMode( WaitMode::BLOCK ),
+	mNumWaiters( 0 ), mWakeRequested( false ), mEventFd( -1 ), mQueueCapacity( 0 ), mQueuePolicy( OverflowPolicy::REJECT ),
+	mNumWaiting( 0 ), mNumBlockedProducers( 0 ), mNumRejected( 0 ), mNumDropped( 0 ), mNumCoalesced( 0 ), mNumBlocked( 0 )
 {
 	
 }
@@ -60,6 +110,7 @@ EventManagerRef EventManager::create( const std::string &name, bool setAsGlobal
 EventManager::~EventManager()
 {
 	CI_LOG_I( "Cleaning up event manager" );
+	destroyPendingAwaiters();
 	mEventListeners.clear();
 	mQueues[0].clear();
 	mQueues[1].clear();
@@ -67,88 +118,117 @@ EventManager::~EventManager()
 	std::lock_guard<std::mutex> lock( mThreadedEventListenerMutex );
 	mThreadedEventListeners.clear();
 	CI_LOG_I( "Removed ALL EVENT LISTENERS" );
+#if defined( __linux__ )
+	if( mEventFd >= 0 )
+		::close( mEventFd );
+#endif
 }
 	
 bool EventManager::addListener( const EventListenerDelegate &eventDelegate, const EventType &type )
 {
 	LOG_EVENT( "Attempting to add delegate function for event type: " + to_string( type ) );
 	
-	auto & eventDelegateList = mEventListeners[type];
-	auto listenIt = eventDelegateList.begin();
-	auto end = eventDelegateList.end();
-	while ( listenIt != end ) {
-		if ( eventDelegate == (*listenIt) ) {
-			CI_LOG_W("Attempting to double-register a delegate");
-			return false;
-		}
-		++listenIt;
-	}
-	eventDelegateList.push_back(eventDelegate);
+	if( ! addListener( EventListener( eventDelegate ), type ) )
+		return false;
 	CI_LOG_V("Successfully added delegate for event type: " + to_string( type ) );
 	return true;
 }
 	
+EventListenerHandle EventManager::addListener( const EventListener &listener, const EventType &type, const EventFilter &filter, EventKey key )
+{
+	LOG_EVENT( "Attempting to add listener for event type: " + to_string( type ) );
+	return mEventListeners.add( listener, type, filter, key );
+}
+	
+bool EventManager::rebindListener( const EventListenerHandle &handle, void *object )
+{
+	return mEventListeners.rebind( handle, object );
+}
+	
+bool EventManager::setListenerFilter( const EventListenerHandle &handle, const EventFilter &filter )
+{
+	return mEventListeners.setFilter( handle, filter );
+}
+	
 bool EventManager::removeListener( const EventListenerDelegate &eventDelegate, const EventType &type )
 {
 	LOG_EVENT("Attempting to remove delegate function from event type: " + to_string( type ) );
-	bool success = false;
-	
-	auto found = mEventListeners.find(type);
-	if( found != mEventListeners.end() ) {
-		auto & listeners = found->second;
-		for( auto listIt = listeners.begin(); listIt != listeners.end(); ++listIt ) {
-			if( eventDelegate == (*listIt) ) {
-				listeners.erase(listIt);
-				LOG_EVENT("Successfully removed delegate function from event type: ");
-				success = true;
-				break;
-			}
-		}
+	
+	if( mEventListeners.remove( eventDelegate, type ) ) {
+		LOG_EVENT("Successfully removed delegate function from event type: ");
+		return true;
 	}
-	return success;
+	return false;
+}
+	
+bool EventManager::removeListener( const EventListenerDelegate &eventDelegate, const EventType &type, EventKey key )
+{
+	return mEventListeners.remove( eventDelegate, type, key );
+}
+	
+bool EventManager::removeListener( const EventListenerHandle &handle )
+{
+	return mEventListeners.remove( handle );
+}
+	
+size_t EventManager::removeAllListenersFor( const void *owner )
+{
+	return mEventListeners.removeAllFor( owner );
+}
+	
+bool EventManager::setEventTypeParent( const EventType &type, const EventType &parent )
+{
+	std::lock_guard<std::mutex> lock( mThreadedEventListenerMutex );
+	if( ! mThreadedEventListeners.setParent( type, parent ) )
+		return false;
+	return mEventListeners.setParent( type, parent );
 }
 	
 bool EventManager::triggerEvent( const EventDataRef &event )
 {
 	//LOG_EVENT("Attempting to trigger event: " + std::string( event->getName() ) );
-	bool processed = false;
-	
-	auto found = mEventListeners.find(event->getEventType());
-	if( found != mEventListeners.end() ) {
-		const auto & eventListenerList = found->second;
-		for( auto listIt = eventListenerList.begin(); listIt != eventListenerList.end(); ++listIt ) {
-			auto& listener = (*listIt);
-			//LOG_EVENT("Sending event " + std::string( event->getName() ) + " to delegate.");
-			listener( event );
-			processed = true;
-		}
-	}
+	TRACE_EVENT_SCOPE( event->getName(), EVENT, event->getEventType() );
+	METRICS_EVENT( mMetrics.recordTriggered( event->getEventType() ) );
+	
+	bool processed = resolveRequest( event );
+	processed |= mEventListeners.dispatch( *event, [&]( EventListener &listener ) {
+		//LOG_EVENT("Sending event " + std::string( event->getName() ) + " to delegate.");
+		TRACE_EVENT_SCOPE( "listener", LISTENER, listener.getId() );
+		INVOKE_LISTENER( listener, event, event->getEventType() );
+	} );
 	
 	return processed;
 }
 	
 bool EventManager::queueEvent( const EventDataRef &event )
 {
-	CI_ASSERT(mActiveQueue < NUM_QUEUES);
-	
 	// make sure the event is valid
 	if( !event ) {
 		CI_LOG_E("Invalid event in queueEvent");
+		return false;
 	}
 	
 //	CI_LOG_V("Attempting to queue event: " + std::string( event->getName() ) );
 	
-	auto found = mEventListeners.find( event->getEventType() );
-	if( found != mEventListeners.end() ) {
-		mQueues[mActiveQueue].push_back(event);
+	// The listener tables belong to the owning thread, so events from other
+	// threads are posted unchecked and filtered when update() drains them.
+	if( ! isOwnerThread() )
+		return postToMailbox( event );
+	
+	CI_ASSERT(mActiveQueue < NUM_QUEUES);
+	
+	// Awaited replies are queued even without listeners, since dispatching
+	// them resolves their request.
+	if( mEventListeners.contains( event->getEventType(), event->getEventKey() ) || isAwaitedReply( event ) ) {
+		if( ! enqueue( event, false ) )
+			return false;
 		LOG_EVENT("Successfully queued event: " + std::string( event->getName() ) );
 		return true;
 	}
 	else {
-		static bool processNotify = false;
-		if( !processNotify ) {
+		static std::atomic<bool> processNotify( false );
+		if( ! processNotify.load( std::memory_order_relaxed ) && ! processNotify.exchange( true ) ) {
 			LOG_EVENT( "Skipping event since there are no delegates to receive it: " + std::string( event->getName() ) );
-			processNotify = true;
 		}
 		return false;
 	}
@@ -156,64 +236,86 @@ bool EventManager::queueEvent( const EventDataRef &event )
 	
 bool EventManager::abortEvent( const EventType &type, bool allOfType )
 {
-	CI_ASSERT(mActiveQueue >= 0);
-	CI_ASSERT(mActiveQueue > NUM_QUEUES);
-	
-	bool success = false;
-	auto found = mEventListeners.find( type );
-	
-	if( found != mEventListeners.end() ) {
-		auto & eventQueue = mQueues[mActiveQueue];
-		auto eventIt = eventQueue.begin();
-		auto end = eventQueue.end();
-		while( eventIt != end ) {
-			
-			if( (*eventIt)->getEventType() == type ) {
-				eventIt = eventQueue.erase(eventIt);
-				success = true;
-				if( ! allOfType )
-					break;
-			}
+	CI_ASSERT(mActiveQueue < NUM_QUEUES);
+	
+	// Events may be queued for types without a table of their own, such as
+	// replies or events heard through a parent type, so the queue is always
+	// searched.
+	size_t numAborted = 0;
+	auto & eventQueue = mQueues[mActiveQueue];
+	auto eventIt = eventQueue.begin();
+	while( eventIt != eventQueue.end() ) {
+		if( (*eventIt)->getEventType() != type ) {
+			++eventIt;
+			continue;
 		}
+		eventIt = eventQueue.erase(eventIt);
+		++numAborted;
+		if( ! allOfType )
+			break;
 	}
+	if( auto limit = findTypeLimit( type ) )
+		limit->mNumQueued -= std::min( limit->mNumQueued, numAborted );
+	releaseWaiting( numAborted );
 	
-	return success;
+	return numAborted > 0;
 }
 	
 bool EventManager::addThreadedListener( const EventListenerDelegate &eventDelegate, const EventType &type )
 {
-	std::lock_guard<std::mutex> lock( mThreadedEventListenerMutex );
-	
-	auto & eventDelegateList = mThreadedEventListeners[type];
-	for ( auto & delegate : eventDelegateList ) {
-		if ( eventDelegate == delegate ) {
-			CI_LOG_W("Attempting to double-register a delegate");
-			return false;
-		}
-	}
-	eventDelegateList.push_back(eventDelegate);
+	if( ! addThreadedListener( EventListener( eventDelegate ), type ) )
+		return false;
 	CI_LOG_V("Successfully added delegate for event type: " + to_string( type ) );
 	return true;
 }
 
+EventListenerHandle EventManager::addThreadedListener( const EventListener &listener, const EventType &type, const EventFilter &filter, EventKey key )
+{
+	std::lock_guard<std::mutex> lock( mThreadedEventListenerMutex );
+	return mThreadedEventListeners.add( listener, type, filter, key );
+}
+
+bool EventManager::rebindThreadedListener( const EventListenerHandle &handle, void *object )
+{
+	std::lock_guard<std::mutex> lock( mThreadedEventListenerMutex );
+	return mThreadedEventListeners.rebind( handle, object );
+}
+
+bool EventManager::setThreadedListenerFilter( const EventListenerHandle &handle, const EventFilter &filter )
+{
+	std::lock_guard<std::mutex> lock( mThreadedEventListenerMutex );
+	return mThreadedEventListeners.setFilter( handle, filter );
+}
+
 bool EventManager::removeThreadedListener( const EventListenerDelegate &eventDelegate, const EventType &type )
 {
 	std::lock_guard<std::mutex> lock( mThreadedEventListenerMutex );
 	
-	auto found = mThreadedEventListeners.find(type);
-	if( found != mThreadedEventListeners.end() ) {
-		auto & listeners = found->second;
-		for( auto listIt = listeners.begin(); listIt != listeners.end(); ++listIt ) {
-			if( eventDelegate == (*listIt) ) {
-				listeners.erase(listIt);
-				LOG_EVENT("Successfully removed delegate function from event type: " << to_string( type ) );
-				return true;
-			}
-		}
+	if( mThreadedEventListeners.remove( eventDelegate, type ) ) {
+		LOG_EVENT("Successfully removed delegate function from event type: " << to_string( type ) );
+		return true;
 	}
 	return false;
 }
 
+bool EventManager::removeThreadedListener( const EventListenerDelegate &eventDelegate, const EventType &type, EventKey key )
+{
+	std::lock_guard<std::mutex> lock( mThreadedEventListenerMutex );
+	return mThreadedEventListeners.remove( eventDelegate, type, key );
+}
+
+bool EventManager::removeThreadedListener( const EventListenerHandle &handle )
+{
+	std::lock_guard<std::mutex> lock( mThreadedEventListenerMutex );
+	return mThreadedEventListeners.remove( handle );
+}
+
+size_t EventManager::removeAllThreadedListenersFor( const void *owner )
+{
+	std::lock_guard<std::mutex> lock( mThreadedEventListenerMutex );
+	return mThreadedEventListeners.removeAllFor( owner );
+}
+
 void EventManager::removeAllThreadedListeners()
 {
 	std::lock_guard<std::mutex> lock( mThreadedEventListenerMutex );
@@ -224,15 +326,14 @@ bool EventManager::triggerThreadedEvent( const EventDataRef &event )
 {
 	std::lock_guard<std::mutex> lock( mThreadedEventListenerMutex );
 	
-	bool processed = false;
-	auto found = mThreadedEventListeners.find(event->getEventType());
-	if( found != mThreadedEventListeners.end() ) {
-		const auto & eventListenerList = found->second;
-		for( auto & listener : eventListenerList ) {
-			listener( event );
-			processed = true;
-		}
-	}
+	TRACE_EVENT_SCOPE( event->getName(), EVENT, event->getEventType() );
+	METRICS_EVENT( mMetrics.recordTriggered( event->getEventType() ) );
+	bool processed = resolveRequest( event );
+	processed |= mThreadedEventListeners.dispatch( *event, [&]( EventListener &listener ) {
+		TRACE_EVENT_SCOPE( "listener", LISTENER, listener.getId() );
+		INVOKE_LISTENER( listener, event, event->getEventType() );
+	} );
+	mThreadedEventListeners.removeExpired( event->getEventType() );
 #if ! defined(SHARINGSTATION)
 	if( ! processed )
 		CI_LOG_E( "Tried triggering MultiThreaded Event without a listener" );
@@ -240,55 +341,385 @@ bool EventManager::triggerThreadedEvent( const EventDataRef &event )
 	return processed;
 }
 	
+EventListenerStats EventManager::getThreadedListenerStats()
+{
+	std::lock_guard<std::mutex> lock( mThreadedEventListenerMutex );
+	return mThreadedEventListeners.getStats();
+}
+
+void EventManager::drainMailbox()
+{
+#if defined( __linux__ )
+	// Cleared before draining, so a post racing with this leaves the fd
+	// readable rather than getting lost.
+	int fd = mEventFd.load( std::memory_order_relaxed );
+	uint64_t count;
+	if( fd >= 0 && ::read( fd, &count, sizeof( count ) ) < 0 && errno != EAGAIN )
+		CI_LOG_W( "Failed to clear the event manager's eventfd" );
+#endif
+	if( mMailbox.empty() )
+		return;
+	size_t numSkipped = 0;
+	mMailbox.drain( [this, &numSkipped]( EventDataRef &&event ) {
+		if( ! mEventListeners.contains( event->getEventType(), event->getEventKey() ) && ! isAwaitedReply( event ) ) {
+			++numSkipped;
+			return;
+		}
+		enqueue( event, true );
+	} );
+	releaseWaiting( numSkipped );
+}
+
+bool EventManager::postToMailbox( const EventDataRef &event )
+{
+	for( ;; ) {
+		// Counted before the push, so the owner never releases more than was
+		// added.
+		auto capacity = mQueueCapacity.load( std::memory_order_relaxed );
+		if( mNumWaiting.fetch_add( 1 ) < capacity || ! capacity )
+			break;
+		mNumWaiting.fetch_sub( 1 );
+		auto policy = mQueuePolicy.load( std::memory_order_relaxed );
+		if( policy != OverflowPolicy::BLOCK_PRODUCER ) {
+			// The mailbox can't give back events it already holds, so only the
+			// new one can go.
+			METRICS_EVENT( mMetrics.recordOverflowed( event->getEventType() ) );
+			if( policy == OverflowPolicy::REJECT ) {
+				mNumRejected.fetch_add( 1, std::memory_order_relaxed );
+				return false;
+			}
+			mNumDropped.fetch_add( 1, std::memory_order_relaxed );
+			return true;
+		}
+		mNumBlocked.fetch_add( 1, std::memory_order_relaxed );
+		std::unique_lock<std::mutex> lock( mRoomMutex );
+		mNumBlockedProducers.fetch_add( 1 );
+		mRoomCondition.wait( lock, [this] {
+			auto capacity = mQueueCapacity.load();
+			return ! capacity || mNumWaiting.load() < capacity;
+		} );
+		mNumBlockedProducers.fetch_sub( 1 );
+	}
+	if( mMailbox.push( event ) )
+		notifyWaiter();
+	return true;
+}
+
+void EventManager::releaseWaiting( size_t count )
+{
+	if( ! count )
+		return;
+	// Pairs with the producer's count of itself as blocked: either it sees
+	// the room, or this sees it waiting.
+	mNumWaiting.fetch_sub( count );
+	if( mNumBlockedProducers.load() ) {
+		std::lock_guard<std::mutex> lock( mRoomMutex );
+		mRoomCondition.notify_all();
+	}
+}
+
+bool EventManager::enqueue( const EventDataRef &event, bool fromMailbox )
+{
+	auto &queue = mQueues[mActiveQueue];
+	auto typeLimit = findTypeLimit( event->getEventType() );
+	if( typeLimit && typeLimit->mNumQueued >= typeLimit->mCapacity ) {
+		auto overflow = makeRoom( event, typeLimit->mPolicy, true, fromMailbox );
+		if( overflow != Overflow::ROOM_MADE ) {
+			if( fromMailbox )
+				releaseWaiting( 1 );
+			return overflow != Overflow::REJECTED;
+		}
+	}
+	if( ! fromMailbox ) {
+		auto capacity = mQueueCapacity.load( std::memory_order_relaxed );
+		if( capacity && mNumWaiting.load() >= capacity ) {
+			auto overflow = makeRoom( event, mQueuePolicy.load( std::memory_order_relaxed ), false, false );
+			if( overflow != Overflow::ROOM_MADE )
+				return overflow != Overflow::REJECTED;
+		}
+		mNumWaiting.fetch_add( 1 );
+	}
+	
+	bool wasEmpty = queue.empty();
+	queue.push_back( event );
+	if( typeLimit )
+		++typeLimit->mNumQueued;
+	// Drained events are processed by the update() draining them.
+	if( wasEmpty && ! fromMailbox )
+		signalEventFd();
+	METRICS_EVENT( mMetrics.recordQueued( event->getEventType() ) );
+	return true;
+}
+
+EventManager::Overflow EventManager::makeRoom( const EventDataRef &event, OverflowPolicy policy, bool ofType, bool fromMailbox )
+{
+	auto &queue = mQueues[mActiveQueue];
+	const auto type = event->getEventType();
+	switch( policy ) {
+		case OverflowPolicy::BLOCK_PRODUCER:
+		case OverflowPolicy::REJECT:
+			// Other threads' queueEvent() has already returned true, so their
+			// events are let through rather than turned away after the fact.
+			if( fromMailbox )
+				return Overflow::ROOM_MADE;
+			METRICS_EVENT( mMetrics.recordOverflowed( type ) );
+			mNumRejected.fetch_add( 1, std::memory_order_relaxed );
+			return Overflow::REJECTED;
+		case OverflowPolicy::DROP_NEWEST:
+			METRICS_EVENT( mMetrics.recordOverflowed( type ) );
+			mNumDropped.fetch_add( 1, std::memory_order_relaxed );
+			return Overflow::DROPPED;
+		case OverflowPolicy::COALESCE: {
+			const auto key = event->getEventKey();
+			auto found = std::find_if( queue.rbegin(), queue.rend(), [&]( const EventDataRef &queued ) {
+				return queued->getEventType() == type && queued->getEventKey() == key;
+			} );
+			if( found != queue.rend() ) {
+				METRICS_EVENT( mMetrics.recordOverflowed( type ) );
+				mNumCoalesced.fetch_add( 1, std::memory_order_relaxed );
+				*found = event;
+				return Overflow::COALESCED;
+			}
+		}
+			// fall through
+		case OverflowPolicy::DROP_OLDEST: {
+			auto found = std::find_if( queue.begin(), queue.end(), [&]( const EventDataRef &queued ) {
+				return ! ofType || queued->getEventType() == type;
+			} );
+			// With every waiting event still in the mailbox there's nothing
+			// older within reach, so the new event goes instead.
+			if( found == queue.end() ) {
+				METRICS_EVENT( mMetrics.recordOverflowed( type ) );
+				mNumDropped.fetch_add( 1, std::memory_order_relaxed );
+				return Overflow::DROPPED;
+			}
+			METRICS_EVENT( mMetrics.recordOverflowed( (*found)->getEventType() ) );
+			mNumDropped.fetch_add( 1, std::memory_order_relaxed );
+			if( auto limit = findTypeLimit( (*found)->getEventType() ) )
+				--limit->mNumQueued;
+			queue.erase( found );
+			releaseWaiting( 1 );
+			return Overflow::ROOM_MADE;
+		}
+	}
+	return Overflow::REJECTED;
+}
+
+EventManager::QueueLimit* EventManager::findTypeLimit( EventType type )
+{
+	if( mTypeLimits.empty() )
+		return nullptr;
+	auto found = mTypeLimits.find( type );
+	return found != mTypeLimits.end() ? &found->second : nullptr;
+}
+
+void EventManager::setQueueCapacity( size_t capacity, OverflowPolicy policy )
+{
+	mQueuePolicy.store( policy );
+	mQueueCapacity.store( capacity );
+	// Blocked producers may fit now, or no longer be meant to block.
+	std::lock_guard<std::mutex> lock( mRoomMutex );
+	mRoomCondition.notify_all();
+}
+
+void EventManager::setQueueCapacity( const EventType &type, size_t capacity, OverflowPolicy policy )
+{
+	CI_ASSERT( isOwnerThread() );
+	if( ! capacity ) {
+		mTypeLimits.erase( type );
+		return;
+	}
+	const auto &queue = mQueues[mActiveQueue];
+	auto numQueued = std::count_if( queue.begin(), queue.end(), [&]( const EventDataRef &queued ) { return queued->getEventType() == type; } );
+	mTypeLimits[type] = { capacity, policy, static_cast<size_t>( numQueued ) };
+}
+
+EventQueueStats EventManager::getQueueStats() const
+{
+	EventQueueStats stats;
+	stats.mNumRejected = mNumRejected.load( std::memory_order_relaxed );
+	stats.mNumDropped = mNumDropped.load( std::memory_order_relaxed );
+	stats.mNumCoalesced = mNumCoalesced.load( std::memory_order_relaxed );
+	stats.mNumBlocked = mNumBlocked.load( std::memory_order_relaxed );
+	return stats;
+}
+
+void EventManager::notifyWaiter()
+{
+	// Pairs with the fence in waitForEvents(): either the waiter sees the
+	// event, or this sees the waiter.
+	std::atomic_thread_fence( std::memory_order_seq_cst );
+	signalEventFd();
+	if( mNumWaiters.load( std::memory_order_relaxed ) == 0 )
+		return;
+	// Taking the lock orders this with the waiter's check of the predicate,
+	// so the notification can't fall between its check and its sleep.
+	{
+		std::lock_guard<std::mutex> lock( mWakeMutex );
+	}
+	mWakeCondition.notify_one();
+}
+
+void EventManager::signalEventFd()
+{
+#if defined( __linux__ )
+	int fd = mEventFd.load( std::memory_order_acquire );
+	const uint64_t one = 1;
+	if( fd >= 0 && ::write( fd, &one, sizeof( one ) ) < 0 )
+		CI_LOG_W( "Failed to signal the event manager's eventfd" );
+#endif
+}
+
+int EventManager::getEventFd()
+{
+#if defined( __linux__ )
+	CI_ASSERT( isOwnerThread() );
+	if( mEventFd < 0 ) {
+		int fd = ::eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+		if( fd < 0 ) {
+			CI_LOG_E( "Failed to create an eventfd for event manager " << getName() );
+			return -1;
+		}
+		mEventFd.store( fd, std::memory_order_release );
+		// Anything queued before the fd existed still needs an update().
+		if( hasQueuedEvents() )
+			signalEventFd();
+	}
+	return mEventFd;
+#else
+	return -1;
+#endif
+}
+
+void EventManager::wake()
+{
+	mWakeRequested.store( true );
+	notifyWaiter();
+}
+
+bool EventManager::waitForEvents( uint64_t timeoutMillis )
+{
+	if( hasQueuedEvents() )
+		return true;
+	const bool isInfinite = timeoutMillis == kINFINITE;
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds( isInfinite ? 0 : timeoutMillis );
+
+	if( mWaitMode == WaitMode::POLL ) {
+		const uint32_t kMaxSpins = 1024;
+		uint32_t spins = 1;
+		while( ! hasQueuedEvents() ) {
+			if( mWakeRequested.load( std::memory_order_relaxed ) && mWakeRequested.exchange( false ) )
+				return false;
+			if( ! isInfinite && std::chrono::steady_clock::now() >= deadline )
+				return false;
+			if( spins <= kMaxSpins ) {
+				for( uint32_t i = 0; i < spins; ++i )
+					cpuRelax();
+				spins *= 2;
+			}
+			else
+				std::this_thread::yield();
+		}
+		return true;
+	}
+
+	mNumWaiters.fetch_add( 1 );
+	std::atomic_thread_fence( std::memory_order_seq_cst );
+	{
+		std::unique_lock<std::mutex> lock( mWakeMutex );
+		auto isReady = [this] { return hasQueuedEvents() || mWakeRequested.load(); };
+		if( isInfinite )
+			mWakeCondition.wait( lock, isReady );
+		else
+			mWakeCondition.wait_until( lock, deadline, isReady );
+	}
+	mNumWaiters.fetch_sub( 1 );
+	mWakeRequested.store( false );
+	return hasQueuedEvents();
+}
+
+bool EventManager::waitAndUpdate( uint64_t timeoutMillis, uint64_t maxMillis )
+{
+	CI_ASSERT( isOwnerThread() );
+	if( ! waitForEvents( timeoutMillis ) )
+		return false;
+	update( maxMillis );
+	return true;
+}
+
+void EventManager::defragmentListeners()
+{
+	if( mDefragmentBudgetMicros == 0 )
+		return;
+	TRACE_EVENT_SCOPE( "EventManager::defragmentListeners", UPDATE, mDefragmentBudgetMicros );
+	auto deadline = getElapsedSeconds() + mDefragmentBudgetMicros * 1e-6;
+	while( mEventListeners.defragmentNext( mSortListenersByTarget ) && getElapsedSeconds() < deadline )
+		;
+	// Threaded listeners only get a turn if no other thread is dispatching.
+	std::unique_lock<std::mutex> lock( mThreadedEventListenerMutex, std::try_to_lock );
+	if( ! lock )
+		return;
+	while( getElapsedSeconds() < deadline && mThreadedEventListeners.defragmentNext( mSortListenersByTarget ) )
+		;
+}
+
 bool EventManager::update( uint64_t maxMillis )
 {
-	uint64_t currMs = app::App::get()->getElapsedSeconds() * 1000;
+	drainMailbox();
+	TRACE_EVENT_SCOPE( "EventManager::update", UPDATE, mQueues[mActiveQueue].size() );
+	uint64_t currMs = getElapsedSeconds() * 1000;
 	uint64_t maxMs = (( maxMillis == EventManager::kINFINITE ) ? (EventManager::kINFINITE) : (currMs + maxMillis) );
 	
 	int queueToProcess = mActiveQueue;
 	mActiveQueue = (mActiveQueue + 1) % NUM_QUEUES;
 	mQueues[mActiveQueue].clear();
+	for( auto &limit : mTypeLimits )
+		limit.second.mNumQueued = 0;
+	releaseWaiting( mQueues[queueToProcess].size() );
 	
-	static bool processNotify = false;
-	if( ! processNotify ) {
+	static std::atomic<bool> processNotify( false );
+	if( ! processNotify.load( std::memory_order_relaxed ) && ! processNotify.exchange( true ) ) {
 		LOG_EVENT("Processing Event Queue " + to_string(queueToProcess) + "; " + to_string(mQueues[queueToProcess].size()) + " events to process");
-		processNotify = true;
 	}
 	
 	while (!mQueues[queueToProcess].empty()) {
 		auto event = mQueues[queueToProcess].front();
 		mQueues[queueToProcess].pop_front();
 		LOG_EVENT("\t\tProcessing Event " + std::string(event->getName()));
+		TRACE_EVENT_SCOPE( event->getName(), EVENT, event->getEventType() );
 		
-		const auto & eventType = event->getEventType();
+		METRICS_EVENT( mMetrics.recordDispatched( event->getEventType(), event->getTimeStamp() > 0.0f ? std::max( getElapsedSeconds() - event->getTimeStamp(), 0.0 ) : -1.0 ) );
 		
-		auto found = mEventListeners.find(eventType);
-		if (found != mEventListeners.end()) {
-			const auto & eventListeners = found->second;
-			LOG_EVENT("\t\tFound " + to_string(eventListeners.size()) + " delegates");
-
-			auto listIt = eventListeners.begin();
-			auto end = eventListeners.end();
-			while (listIt != end) {
-				auto listener = (*listIt);
-				LOG_EVENT("\t\tSending Event " + std::string(event->getName()) + " to delegate");
-				listener(event);
-				listIt++;
-			}
-		}
+		resolveRequest( event );
+		mEventListeners.dispatch( *event, [&]( EventListener &listener ) {
+			LOG_EVENT("\t\tSending Event " + std::string(event->getName()) + " to delegate");
+			TRACE_EVENT_SCOPE( "listener", LISTENER, listener.getId() );
+			INVOKE_LISTENER( listener, event, event->getEventType() );
+		} );
 		
-		currMs = app::App::get()->getElapsedSeconds() * 1000;//Engine::getTickCount();
+		currMs = getElapsedSeconds() * 1000;//Engine::getTickCount();
 		if( maxMillis != EventManager::kINFINITE && currMs >= maxMs ) {
 			LOG_EVENT("Aborting event processing; time ran out");
 			break;
 		}
 	}
 	
+	// Weak listeners found expired by this update, or by triggerEvent() since
+	// the last one, are dropped here rather than mid-dispatch.
+	mEventListeners.removeExpired();
+	defragmentListeners();
+	
 	bool queueFlushed = mQueues[queueToProcess].empty();
+	// Leftovers and events queued by listeners need another update().
+	if( ! queueFlushed || ! mQueues[mActiveQueue].empty() )
+		signalEventFd();
 	if( ! queueFlushed ) {
+		mNumWaiting.fetch_add( mQueues[queueToProcess].size() );
 		while( ! mQueues[queueToProcess].empty() ) {
 			auto event = mQueues[queueToProcess].back();
 			mQueues[queueToProcess].pop_back();
+			if( auto limit = findTypeLimit( event->getEventType() ) )
+				++limit->mNumQueued;
 			mQueues[mActiveQueue].push_front(event);
 		}
 	}
@@ -39,20 +39,36 @@
 #pragma once
 
 #include "EventManagerBase.h"
+#include "EventMailbox.h"
+#include "EventMetrics.h"
+#include "EventRequests.h"
 
 #include <deque>
+#include <limits>
 #include <map>
 #include <array>
-#include <list>
 #include <atomic>
+#include <condition_variable>
 #include <mutex>
+#include <thread>
+#include <unordered_map>
 	
 const uint32_t NUM_QUEUES = 2u;
 using EventManagerRef = std::shared_ptr<class EventManager>;
+
+//! Events turned away by a full queue, see EventManager::setQueueCapacity().
+struct EventQueueStats {
+	//! Refused; queueEvent() returned false.
+	uint64_t	mNumRejected = 0;
+	//! Discarded to stay within capacity, whether new or already queued.
+	uint64_t	mNumDropped = 0;
+	//! Replaced in the queue by a newer event of the same type and key.
+	uint64_t	mNumCoalesced = 0;
+	//! Times another thread's queueEvent() had to wait for room.
+	uint64_t	mNumBlocked = 0;
+};
 	
 class EventManager : public EventManagerBase {
-	using EventListenerList = std::list<EventListenerDelegate>;
-	using EventListenerMap	= std::map<EventType, EventListenerList>;
 	using EventQueue		= std::deque<EventDataRef>;
 	
 public:
@@ -61,28 +77,258 @@ public:
 	
 	virtual ~EventManager();
 	
+	using EventManagerBase::addListener;
+	using EventManagerBase::addThreadedListener;
+	
 	virtual bool addListener( const EventListenerDelegate &eventDelegate, const EventType &type ) override;
+	virtual EventListenerHandle addListener( const EventListener &listener, const EventType &type, const EventFilter &filter, EventKey key ) override;
 	virtual bool removeListener( const EventListenerDelegate &eventDelegate, const EventType &type ) override;
+	virtual bool removeListener( const EventListenerDelegate &eventDelegate, const EventType &type, EventKey key ) override;
+	virtual bool removeListener( const EventListenerHandle &handle ) override;
+	virtual bool rebindListener( const EventListenerHandle &handle, void *object ) override;
+	virtual bool setListenerFilter( const EventListenerHandle &handle, const EventFilter &filter ) override;
+	virtual size_t removeAllListenersFor( const void *owner ) override;
+	virtual bool setEventTypeParent( const EventType &type, const EventType &parent ) override;
 	
 	virtual bool triggerEvent( const EventDataRef &event ) override;
 	virtual bool queueEvent( const EventDataRef &event ) override;
 	virtual bool abortEvent( const EventType &type, bool allOfType = false ) override;
 	
 	virtual bool addThreadedListener( const EventListenerDelegate &eventDelegate, const EventType &type ) override;
+	virtual EventListenerHandle addThreadedListener( const EventListener &listener, const EventType &type, const EventFilter &filter, EventKey key ) override;
 	virtual bool removeThreadedListener( const EventListenerDelegate &eventDelegate, const EventType &type ) override;
+	virtual bool removeThreadedListener( const EventListenerDelegate &eventDelegate, const EventType &type, EventKey key ) override;
+	virtual bool removeThreadedListener( const EventListenerHandle &handle ) override;
+	virtual bool rebindThreadedListener( const EventListenerHandle &handle, void *object ) override;
+	virtual bool setThreadedListenerFilter( const EventListenerHandle &handle, const EventFilter &filter ) override;
+	virtual size_t removeAllThreadedListenersFor( const void *owner ) override;
 	virtual void removeAllThreadedListeners() override;
 	virtual bool triggerThreadedEvent( const EventDataRef &event ) override;
 	
 	virtual bool update( uint64_t maxMillis = kINFINITE ) override;
+	
+	//! Makes the calling thread the one that owns this manager: it runs
+	//! update() and registers listeners. Defaults to the thread that created
+	//! the manager. queueEvent() calls from any other thread go to a lock-free
+	//! mailbox that update() drains, so each worker thread can own a manager
+	//! and post events to the others' without locking or racing them.
+	void setOwnerThread() { mOwnerThread = std::this_thread::get_id(); }
+	bool isOwnerThread() const { return std::this_thread::get_id() == mOwnerThread; }
+	
+	//! How waitAndUpdate() waits for events. BLOCK parks the thread on a
+	//! condition variable until another thread queues an event, costing no CPU
+	//! while idle. POLL spins with exponential backoff, yielding once the
+	//! backoff is spent, for the lowest wake-up latency at the cost of a core.
+	enum class WaitMode { BLOCK, POLL };
+	void setWaitMode( WaitMode mode ) { mWaitMode = mode; }
+	WaitMode getWaitMode() const { return mWaitMode; }
+	//! For service threads that own this manager: waits up to \a timeoutMillis
+	//! for queued events, then processes them with update( \a maxMillis ).
+	//! queueEvent() calls from other threads end the wait. Returns false if it
+	//! timed out, or was ended by wake(), with nothing to process.
+	bool waitAndUpdate( uint64_t timeoutMillis = kINFINITE, uint64_t maxMillis = kINFINITE );
+	//! Ends the current waitAndUpdate(), or the next one if none is waiting,
+	//! e.g. so its thread can shut down. Thread Safe.
+	void wake();
+	//! Returns a non-blocking eventfd that is readable whenever update() has
+	//! events to process, for driving this manager from an epoll or other
+	//! reactor loop on the owning thread instead of a fixed-rate tick. Created
+	//! on first use and owned by the manager; update() clears it. Returns -1
+	//! where eventfd isn't available, i.e. off Linux.
+	//!
+	//! \code
+	//! epoll_event watch = { EPOLLIN, { manager.get() } };
+	//! epoll_ctl( epollFd, EPOLL_CTL_ADD, manager->getEventFd(), &watch );
+	//! // ... when it's reported readable:
+	//! manager->update();
+	//! \endcode
+	int getEventFd();
+	
+	//! Queues \a query under a new correlation id and returns a future for
+	//! the Resp event answering it. Whoever handles the query, in update() or
+	//! on another thread through a threaded listener, marks its reply with
+	//! reply->replyTo( *query ) and queues or triggers it as usual; the future
+	//! is resolved as that reply is dispatched. The request times out after
+	//! \a timeoutSeconds on this manager's clock, or never if negative. Call
+	//! from the owning thread. If nothing listens for the query, or it can't
+	//! be queued, e.g. because its queue is full, no request is left open and
+	//! the future is invalid.
+	//!
+	//! \code
+	//! auto path = manager->request<PathQueryEvent, PathReplyEvent>( query, 0.5 );
+	//! // ... on a later frame:
+	//! if( auto reply = path.get() )
+	//!		followPath( reply->getPath() );
+	//! \endcode
+	template<typename Req, typename Resp>
+	EventFuture<Resp> request( const std::shared_ptr<Req> &query, double timeoutSeconds = -1.0 );
+	//! Requests waiting for a reply, or whose reply hasn't been taken yet.
+	size_t getNumPendingRequests() const { return mRequests.size(); }
+	
+	//! What queueEvent() does with an event that finds its queue full.
+	enum class OverflowPolicy {
+		//! The new event is refused and queueEvent() returns false.
+		REJECT,
+		//! The new event is discarded, though queueEvent() returns true.
+		DROP_NEWEST,
+		//! The oldest queued event is discarded to make room.
+		DROP_OLDEST,
+		//! The new event takes the place of the newest queued event of the same
+		//! type and key, e.g. to keep only the latest position. Without one, as
+		//! DROP_OLDEST.
+		COALESCE,
+		//! Other threads' queueEvent() waits until update() makes room. On the
+		//! owning thread, which would be waiting for itself, as REJECT.
+		BLOCK_PRODUCER
+	};
+	//! Bounds the events waiting for the next update() to \a capacity, or
+	//! lifts the bound for a \a capacity of 0, the default. Events queued on
+	//! the owning thread and from other threads count against the same bound,
+	//! and queueEvent() decides each one's fate once, when it's called. Other
+	//! threads can't reach the events already queued, so for them DROP_OLDEST
+	//! and COALESCE drop the new event, like DROP_NEWEST. Leftovers of a
+	//! time-limited update() stay queued even if they exceed the bound.
+	void setQueueCapacity( size_t capacity, OverflowPolicy policy = OverflowPolicy::REJECT );
+	//! Bounds the queued events of \a type alone, checked before the capacity
+	//! of the whole queue. Other threads can't check it, so their events meet
+	//! it when update() takes them in: the dropping policies apply as usual,
+	//! but REJECT and BLOCK_PRODUCER let them through, since their
+	//! queueEvent() has already returned true. A \a capacity of 0 removes the
+	//! bound. Call from the owning thread.
+	//!
+	//! \code
+	//! manager->setQueueCapacity( MousePositionEvent::TYPE, 1, EventManager::OverflowPolicy::COALESCE );
+	//! \endcode
+	void setQueueCapacity( const EventType &type, size_t capacity, OverflowPolicy policy = OverflowPolicy::REJECT );
+	//! Counts of events turned away by full queues so far. Thread Safe.
+	EventQueueStats getQueueStats() const;
+	
+	//! Time update() may spend defragmenting listener tables, one table at a
+	//! time, after it has processed the queue. 0 disables it. Defaults to
+	//! 100 microseconds.
+	void setDefragmentBudget( uint64_t micros ) { mDefragmentBudgetMicros = micros; }
+	uint64_t getDefragmentBudget() const { return mDefragmentBudgetMicros; }
+	//! When enabled, defragmenting also orders each event type's listeners by
+	//! the address of the object they call, so dispatch walks memory forwards.
+	//! Listeners are then no longer called in registration order. Off by default.
+	void setSortListenersByTarget( bool sort ) { mSortListenersByTarget = sort; }
+	bool getSortListenersByTarget() const { return mSortListenersByTarget; }
+	//! Routes events of \a type through a uniform grid of \a cellSize over
+	//! filter fields \a xField and \a yField, e.g. a positional event's x and
+	//! y. Listeners registered with a box filter on both fields are then only
+	//! tested against events inside their cells, instead of against every
+	//! event. Keep the boxes current with setListenerFilter(). A \a cellSize
+	//! of 0 turns routing off. Applies to update()/triggerEvent() listeners.
+	//!
+	//! \code
+	//! manager->setSpatialIndex( MousePositionEvent::TYPE, MousePositionEvent::FIELD_X, MousePositionEvent::FIELD_Y, 64 );
+	//! \endcode
+	void setSpatialIndex( const EventType &type, uint32_t xField, uint32_t yField, double cellSize ) { mEventListeners.setSpatialIndex( type, xField, yField, cellSize ); }
+	//! Slot usage and fragmentation of the update()/triggerEvent() listeners.
+	EventListenerStats getListenerStats() const { return mEventListeners.getStats(); }
+	//! Slot usage and fragmentation of the threaded listeners. Thread Safe.
+	EventListenerStats getThreadedListenerStats();
+	
+#if defined( EVENT_MANAGER_ENABLE_METRICS )
+	//! Returns per event type counts and queue wait times and per listener
+	//! dispatch latencies gathered so far. Safe to call from any thread.
+	EventMetricsSnapshot snapshotMetrics() const { return mMetrics.snapshot(); }
+#endif
 
 private:
 	explicit EventManager( const std::string &name, bool setAsGlobal );
 	
+	//! Spends up to the defragment budget on listener tables.
+	void defragmentListeners();
+	//! Moves events other threads queued into the active queue.
+	void drainMailbox();
+	//! Returns true once there are events to process.
+	bool waitForEvents( uint64_t timeoutMillis );
+	bool hasQueuedEvents() const { return ! mQueues[mActiveQueue].empty() || ! mMailbox.empty(); }
+	//! Wakes a thread blocked in waitAndUpdate(), if any, and signals the
+	//! eventfd.
+	void notifyWaiter();
+	void signalEventFd();
+	struct QueueLimit {
+		size_t			mCapacity;
+		OverflowPolicy	mPolicy;
+		//! Events of the type in the active queue.
+		size_t			mNumQueued;
+	};
+	enum class Overflow { ROOM_MADE, REJECTED, DROPPED, COALESCED };
+	
+	//! Appends \a event to the active queue within its capacities. Events from
+	//! the mailbox were admitted against the whole queue's capacity when they
+	//! were posted, so only per-type bounds are checked for them. Returns
+	//! false if it was rejected.
+	bool enqueue( const EventDataRef &event, bool fromMailbox );
+	//! Applies \a policy to an active queue that is full, counting only events
+	//! of \a event's type if \a ofType.
+	Overflow makeRoom( const EventDataRef &event, OverflowPolicy policy, bool ofType, bool fromMailbox );
+	QueueLimit* findTypeLimit( EventType type );
+	//! Posts an event from another thread, within the queue's capacity.
+	bool postToMailbox( const EventDataRef &event );
+	//! Gives back the capacity held by \a count events leaving the queue or
+	//! the mailbox, waking producers blocked on it.
+	void releaseWaiting( size_t count );
+	//! True if \a event is a reply an open request is still waiting for.
+	bool isAwaitedReply( const EventDataRef &event ) { return mRequests.isAwaiting( event->getCorrelationId(), event->getEventType() ); }
+	//! Resolves the request \a event replies to, if any. Returns true if it did.
+	bool resolveRequest( const EventDataRef &event )
+	{
+		return event->getCorrelationId() && mRequests.resolve( event->getCorrelationId(), event, getElapsedSeconds() );
+	}
+	
 	std::mutex							mThreadedEventListenerMutex;
-	EventListenerMap					mThreadedEventListeners;
+	EventListenerRegistry				mThreadedEventListeners;
 	
-	EventListenerMap					mEventListeners;
+	EventListenerRegistry				mEventListeners;
 	std::array<EventQueue, NUM_QUEUES>  mQueues;
 	uint32_t							mActiveQueue;
+	uint64_t							mDefragmentBudgetMicros;
+	bool								mSortListenersByTarget;
+	std::thread::id						mOwnerThread;
+	EventMailbox						mMailbox;
+	WaitMode							mWaitMode;
+	std::mutex							mWakeMutex;
+	std::condition_variable				mWakeCondition;
+	std::atomic<uint32_t>				mNumWaiters;
+	std::atomic<bool>					mWakeRequested;
+	std::atomic<int>					mEventFd;
+	EventRequestTable					mRequests;
+	std::atomic<size_t>					mQueueCapacity;
+	std::atomic<OverflowPolicy>			mQueuePolicy;
+	std::unordered_map<EventType, QueueLimit>	mTypeLimits;
+	//! Events waiting for the next update(), in the active queue or posted to
+	//! the mailbox. The queue capacity bounds this single count.
+	std::atomic<size_t>					mNumWaiting;
+	std::mutex							mRoomMutex;
+	std::condition_variable				mRoomCondition;
+	std::atomic<uint32_t>				mNumBlockedProducers;
+	std::atomic<uint64_t>				mNumRejected;
+	std::atomic<uint64_t>				mNumDropped;
+	std::atomic<uint64_t>				mNumCoalesced;
+	std::atomic<uint64_t>				mNumBlocked;
+	
+#if defined( EVENT_MANAGER_ENABLE_METRICS )
+	EventMetrics						mMetrics;
+#endif
+
+};
 
-};
\ No newline at end of file
+template<typename Req, typename Resp>
+EventFuture<Resp> EventManager::request( const std::shared_ptr<Req> &query, double timeoutSeconds )
+{
+	static_assert( std::is_base_of<EventData, Req>::value && std::is_base_of<EventData, Resp>::value, "Requests and replies must be events" );
+	if( ! mEventListeners.contains( query->getEventType(), query->getEventKey() ) )
+		return EventFuture<Resp>();
+	const double deadline = timeoutSeconds < 0.0 ? std::numeric_limits<double>::infinity() : getElapsedSeconds() + timeoutSeconds;
+	auto id = mRequests.open( Resp::TYPE, deadline );
+	query->setCorrelationId( id );
+	if( ! queueEvent( query ) ) {
+		mRequests.close( id );
+		query->setCorrelationId( 0 );
+		return EventFuture<Resp>();
+	}
+	return EventFuture<Resp>( &mRequests, getClock(), id );
+}
\ No newline at end of file
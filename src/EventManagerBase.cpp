@@ -37,31 +37,103 @@
 //========================================================================
 
 #include "EventManagerBase.h"
-#include "cinder/Log.h"
+
+#include <algorithm>
+#include <atomic>
+
+#if ! defined( EVENT_MANAGER_NO_CINDER )
+#include "cinder/app/App.h"
+#else
+#include <chrono>
+#endif
 	
-static EventManagerBase* kEventManager = nullptr;
+static std::atomic<EventManagerBase*> kEventManager( nullptr );
+static thread_local EventManagerBase* kCurrentEventManager = nullptr;
+
+static double defaultClock()
+{
+#if ! defined( EVENT_MANAGER_NO_CINDER )
+	auto app = ci::app::App::get();
+	return app ? app->getElapsedSeconds() : 0.0;
+#else
+	static const auto start = std::chrono::steady_clock::now();
+	return std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+#endif
+}
+	
+EventManagerBase::ClockFn EventManagerBase::getDefaultClock()
+{
+	return &defaultClock;
+}
 	
 EventManagerBase* EventManagerBase::get()
 {
-	return kEventManager;
+	return kCurrentEventManager ? kCurrentEventManager : kEventManager.load( std::memory_order_acquire );
+}
+	
+EventManagerBase* EventManagerBase::getGlobal()
+{
+	return kEventManager.load( std::memory_order_acquire );
+}
+	
+EventManagerBase* EventManagerBase::setCurrent( EventManagerBase *manager )
+{
+	auto previous = kCurrentEventManager;
+	kCurrentEventManager = manager;
+	return previous;
 }
 	
 EventManagerBase::EventManagerBase( const std::string &name, bool setAsGlobal )
+: mName( name ), mClock( getDefaultClock() )
 {
 	if ( setAsGlobal ) {
-		if ( kEventManager ) {
-			CI_LOG_E("Attempting to make two Event Managers. Deleting the old one and replacing with the new one");
-			delete kEventManager;
-		}
-		kEventManager = this;
+		// The old global is owned by whoever created it, so it's only replaced.
+		if ( kEventManager.exchange( this, std::memory_order_acq_rel ) )
+			CI_LOG_W( "Replacing the global Event Manager with " << name );
+	}
+}
+	
+EventListenerHandle EventManagerBase::forwardEvents( const EventType &type, const std::shared_ptr<EventManagerBase> &target )
+{
+	// Forwarding to itself would requeue every event forever.
+	CI_ASSERT( target.get() != this );
+	if( target.get() == this ) {
+		CI_LOG_E( "Event manager " << mName << " can't forward events to itself" );
+		return EventListenerHandle();
+	}
+	std::weak_ptr<EventManagerBase> weakTarget = target;
+	return addListener( [weakTarget]( EventDataRef event ) {
+		if( auto manager = weakTarget.lock() )
+			manager->queueEvent( event );
+	}, type );
+}
+	
+void EventManagerBase::removePendingAwaiter( EventAwaiter *awaiter )
+{
+	auto found = std::find( mPendingAwaiters.begin(), mPendingAwaiters.end(), awaiter );
+	if( found != mPendingAwaiters.end() ) {
+		*found = mPendingAwaiters.back();
+		mPendingAwaiters.pop_back();
+	}
+}
+	
+void EventManagerBase::destroyPendingAwaiters()
+{
+	// A frame's locals may end other coroutines' waits as they're destroyed,
+	// taking them off the list, so it's re-checked every time.
+	while( ! mPendingAwaiters.empty() ) {
+		auto awaiter = mPendingAwaiters.back();
+		mPendingAwaiters.pop_back();
+		awaiter->destroyCoroutine();
 	}
 }
 	
 EventManagerBase::~EventManagerBase()
 {
-	/*if ( kEventManager ) {
-		auto tempManagerForDelete = kEventManager;
-		kEventManager = nullptr;
-		delete tempManagerForDelete;
-	}*/
+	// Other threads' current managers can't be reached from here; those
+	// threads must reset them before the manager goes away.
+	auto self = this;
+	kEventManager.compare_exchange_strong( self, nullptr, std::memory_order_acq_rel );
+	if ( kCurrentEventManager == this )
+		kCurrentEventManager = nullptr;
 }
\ No newline at end of file
@@ -39,26 +39,179 @@
 #pragma once
 
 #include <string>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
 #include "BaseEventData.h"
-#include "FastDelegate.h"
+#include "EventListenerTable.h"
 	
 using EventType				= uint64_t;
-using EventListenerDelegate = fastdelegate::FastDelegate1<EventDataRef, void>;
+using EventListenerDelegate = Delegate<void( EventDataRef )>;
+
+//! Enables the callable overloads of addListener() for anything that isn't
+//! already a delegate or a listener slot.
+template<typename Callable>
+using EnableIfListenerCallable = typename std::enable_if<
+	! std::is_same<typename std::decay<Callable>::type, EventListenerDelegate>::value &&
+	! std::is_same<typename std::decay<Callable>::type, EventListener>::value>::type;
+
+class ScopedListener;
+
+//! An awaitable whose coroutine is suspended until a manager resumes it. A
+//! manager destroyed first destroys these coroutines, since nothing else
+//! would ever resume or free them. Declared whatever the language version,
+//! so managers look the same to C++14 and C++20 code.
+class EventAwaiter {
+public:
+	//! Destroys the suspended coroutine, without calling back into the
+	//! manager that's being destroyed.
+	virtual void destroyCoroutine() = 0;
+
+protected:
+	~EventAwaiter() = default;
+};
+
+#if defined( __cpp_impl_coroutine )
+template<typename EventT, typename Predicate>
+class EventAwaitable;
+struct AnyEvent;
+#endif
 
 class EventManagerBase {
 public:
 	
 	enum eConstants { kINFINITE = 0xffffffff };
+	//! Returns the elapsed time in seconds. Used to time-limit update().
+	using ClockFn = double (*)();
+	
 	explicit EventManagerBase( const std::string &name, bool setAsGlobal );
 	virtual ~EventManagerBase();
 	
+	//! Replaces the clock used by this manager. Passing nullptr restores the
+	//! default, which is the app's elapsed seconds when built with Cinder and
+	//! a monotonic clock otherwise.
+	void setClock( ClockFn clock ) { mClock = clock ? clock : getDefaultClock(); }
+	ClockFn getClock() const { return mClock; }
+	double getElapsedSeconds() const { return mClock(); }
+	static ClockFn getDefaultClock();
+	
 	//! Registers a delegate function that will get called when the event type is
 	//! triggered. Returns true if successful, false if not.
 	virtual bool addListener( const EventListenerDelegate &eventDelegate, const EventType &type ) = 0;
+	//! Registers a callable, such as a capturing lambda, taking an EventDataRef.
+	//! Trivially copyable callables of up to EventListener::kInlineStorageSize
+	//! bytes live inside the listener slot, so registering them doesn't
+	//! allocate. Returns a handle to remove the listener with.
+	template<typename Callable, typename = EnableIfListenerCallable<Callable>>
+	EventListenerHandle addListener( Callable &&callable, const EventType &type )
+	{
+		return addListener( EventListener( std::forward<Callable>( callable ) ), type );
+	}
+	//! Registers a delegate that is only called for events passing \a filter.
+	//! The filter is tested by the dispatcher, before the delegate is called.
+	bool addListener( const EventListenerDelegate &eventDelegate, const EventType &type, const EventFilter &filter )
+	{
+		return static_cast<bool>( addListener( EventListener( eventDelegate ), type, filter ) );
+	}
+	//! Registers a callable that is only called for events passing \a filter.
+	template<typename Callable, typename = EnableIfListenerCallable<Callable>>
+	EventListenerHandle addListener( Callable &&callable, const EventType &type, const EventFilter &filter )
+	{
+		return addListener( EventListener( std::forward<Callable>( callable ) ), type, filter );
+	}
+	//! Registers a delegate that only hears events of \a type whose
+	//! getEventKey() is \a key, such as one entity's state changes. Dispatch
+	//! finds these listeners by key, so they cost nothing for other keys.
+	bool addListener( const EventListenerDelegate &eventDelegate, const EventType &type, EventKey key )
+	{
+		return static_cast<bool>( addListener( EventListener( eventDelegate ), type, key ) );
+	}
+	template<typename Callable, typename = EnableIfListenerCallable<Callable>>
+	EventListenerHandle addListener( Callable &&callable, const EventType &type, EventKey key )
+	{
+		return addListener( EventListener( std::forward<Callable>( callable ) ), type, key );
+	}
+	//! Registers \a Method of \a object without extending its lifetime. The
+	//! listener goes quiet once \a object expires and is dropped on a later
+	//! update(), so no removeListener() call is needed.
+	template<typename T, void (T::*Method)( EventDataRef )>
+	EventListenerHandle addWeakListener( const std::weak_ptr<T> &object, const EventType &type )
+	{
+		return addListener( EventListener::weak<T, Method>( object ), type );
+	}
+	//! Registers a one-shot delegate. The dispatcher removes it as it calls it,
+	//! so it hears at most one event and never needs a removeListener() call.
+	//! The handle can still cancel it before it fires.
+	EventListenerHandle addListenerOnce( const EventListenerDelegate &eventDelegate, const EventType &type, const EventFilter &filter = EventFilter() )
+	{
+		return addListenerOnce( EventListener( eventDelegate ), type, filter );
+	}
+	template<typename Callable, typename = EnableIfListenerCallable<Callable>>
+	EventListenerHandle addListenerOnce( Callable &&callable, const EventType &type, const EventFilter &filter = EventFilter() )
+	{
+		return addListenerOnce( EventListener( std::forward<Callable>( callable ) ), type, filter );
+	}
+	EventListenerHandle addListenerOnce( const EventListener &listener, const EventType &type, const EventFilter &filter = EventFilter(), EventKey key = NO_EVENT_KEY )
+	{
+		EventListener once = listener;
+		once.setOnce();
+		return addListener( once, type, filter, key );
+	}
+	//! Registers a prepared listener slot. Returns a handle to remove it with,
+	//! or an empty handle if the slot's delegate is already registered.
+	EventListenerHandle addListener( const EventListener &listener, const EventType &type )
+	{
+		return addListener( listener, type, EventFilter(), NO_EVENT_KEY );
+	}
+	EventListenerHandle addListener( const EventListener &listener, const EventType &type, const EventFilter &filter )
+	{
+		return addListener( listener, type, filter, NO_EVENT_KEY );
+	}
+	EventListenerHandle addListener( const EventListener &listener, const EventType &type, EventKey key )
+	{
+		return addListener( listener, type, EventFilter(), key );
+	}
+	//! Registers \a listener for events of \a type that pass \a filter. If
+	//! \a key isn't NO_EVENT_KEY the listener only hears events whose
+	//! getEventKey() is \a key, and other keys' events never reach it.
+	virtual EventListenerHandle addListener( const EventListener &listener, const EventType &type, const EventFilter &filter, EventKey key ) = 0;
+	//! Registers \a eventDelegate and returns a token that removes it again
+	//! when destroyed. The token is empty if the delegate was already registered.
+	ScopedListener addScopedListener( const EventListenerDelegate &eventDelegate, const EventType &type );
+	//! Scoped counterpart of the filtered addListener().
+	ScopedListener addScopedListener( const EventListenerDelegate &eventDelegate, const EventType &type, const EventFilter &filter );
+	//! Points the delegate listener \a handle at \a object without re-registering
+	//! it, e.g. after the object it was bound to has been moved. Returns false for
+	//! callables or stale handles.
+	virtual bool rebindListener( const EventListenerHandle &handle, void *object ) = 0;
+	//! Replaces the filter of the listener \a handle, e.g. the box of an
+	//! object that moved, without re-registering it. Returns false for stale
+	//! handles or filters the event type's table can't take.
+	virtual bool setListenerFilter( const EventListenerHandle &handle, const EventFilter &filter ) = 0;
 	
 	//! Removes a delegate / event type pairing from the internal tables.
 	//! Returns false if the pairing was not found.
 	virtual bool removeListener( const EventListenerDelegate &eventDelegate, const EventType &type ) = 0;
+	//! Removes a delegate registered for one key of \a type.
+	virtual bool removeListener( const EventListenerDelegate &eventDelegate, const EventType &type, EventKey key ) = 0;
+	//! Removes the listener identified by \a handle. Returns false if it was
+	//! already removed.
+	virtual bool removeListener( const EventListenerHandle &handle ) = 0;
+	//! Removes every delegate listener bound to \a owner, across all event
+	//! types, e.g. from an object's destructor. Costs time proportional to the
+	//! owner's own subscriptions. Returns how many listeners were removed.
+	virtual size_t removeAllListenersFor( const void *owner ) = 0;
+	
+	//! Makes listeners of \a parent also receive events of \a type and of all
+	//! its descendants, for both regular and threaded listeners. Register for
+	//! ANY_EVENT_TYPE to receive every event, and pass it as \a parent to
+	//! detach \a type again. Returns false if that would create a cycle.
+	//!
+	//! \code
+	//! manager->setEventTypeParent( MousePositionEvent::TYPE, InputEvent::TYPE );
+	//! manager->addListener( inputDelegate, InputEvent::TYPE );
+	//! \endcode
+	virtual bool setEventTypeParent( const EventType &type, const EventType &parent ) = 0;
 	
 	//! Fires off event NOW. This bypasses the queue entirely and immediately
 	//! calls all delegate functions registered for the event.
@@ -66,6 +219,8 @@ public:
 	
 	//! Fires off event. This uses the queue and will call the delegate
 	//! function on the next call to tickUpdate. assuming there's enough time.
+	//! Thread Safe for EventManager: calls from threads other than the owning
+	//! one are posted to its mailbox, see EventManager::setOwnerThread().
 	virtual bool queueEvent( const EventDataRef &event ) = 0;
 	
 	// Finds the next-available instance of the named event type and remove it
@@ -87,24 +242,232 @@ public:
 	// otherwise (e.g. timeout).
 	virtual bool update( uint64_t maxMillis = kINFINITE ) = 0;
 	
-	// Getter for the main global event manager. This is the event manager that
-	// is used by the majority of the engine, though you are free to define your
-	// own as long as you instantiate it with setAsGlobal set to false.
-	// It is not valid to have more than one global event manager.
+	// Getter for the event manager the calling code should use: the calling
+	// thread's current manager if it has one, otherwise the global one. Any
+	// number of managers may exist, e.g. one per subsystem, thread or world;
+	// only one of them is global, the one last created with setAsGlobal.
 	static EventManagerBase* get();
+	//! The manager last created with setAsGlobal, or nullptr once it's gone.
+	static EventManagerBase* getGlobal();
+	//! Makes \a manager the calling thread's current manager, returned by
+	//! get() on this thread. nullptr falls back to the global one. Returns the
+	//! previous current manager. See CurrentEventManagerScope.
+	static EventManagerBase* setCurrent( EventManagerBase *manager );
+	
+	const std::string& getName() const { return mName; }
+	
+	//! Queues every event of \a type that reaches this manager on \a target
+	//! too, so a subsystem can hand events to another subsystem's manager
+	//! without either one funneling everything. Both managers see the same
+	//! event object. \a target is held weakly and may be owned by another
+	//! thread. Returns a handle to stop forwarding with removeListener(), or
+	//! an empty handle if \a target is this manager.
+	EventListenerHandle forwardEvents( const EventType &type, const std::shared_ptr<EventManagerBase> &target );
+	
+#if defined( __cpp_impl_coroutine )
+	//! C++20 only. Returns an awaitable that resumes the calling coroutine
+	//! with the next event of EventT::TYPE for which \a predicate( const
+	//! EventT& ) is true. Defined in EventAwaitable.h, which has the details.
+	template<typename EventT, typename Predicate = AnyEvent>
+	EventAwaitable<EventT, Predicate> next( Predicate predicate = Predicate() );
+#endif
 	
 	//! Registers a delegate function that will get called when the event type is
 	//! triggered. NOTE: This listener can be called from any thread. Appropriate
 	//! locks in the listener should be considered. Returns true if successful,
 	//! false if not. This function is Thread Safe
 	virtual bool addThreadedListener( const EventListenerDelegate &eventDelegate, const EventType &type ) = 0;
+	//! Thread Safe counterpart of the callable addListener().
+	template<typename Callable, typename = EnableIfListenerCallable<Callable>>
+	EventListenerHandle addThreadedListener( Callable &&callable, const EventType &type )
+	{
+		return addThreadedListener( EventListener( std::forward<Callable>( callable ) ), type );
+	}
+	//! Thread Safe counterpart of addWeakListener(). Expired listeners are
+	//! dropped right after the dispatch that finds them.
+	template<typename T, void (T::*Method)( EventDataRef )>
+	EventListenerHandle addWeakThreadedListener( const std::weak_ptr<T> &object, const EventType &type )
+	{
+		return addThreadedListener( EventListener::weak<T, Method>( object ), type );
+	}
+	//! Thread Safe counterpart of the filtered addListener().
+	bool addThreadedListener( const EventListenerDelegate &eventDelegate, const EventType &type, const EventFilter &filter )
+	{
+		return static_cast<bool>( addThreadedListener( EventListener( eventDelegate ), type, filter ) );
+	}
+	template<typename Callable, typename = EnableIfListenerCallable<Callable>>
+	EventListenerHandle addThreadedListener( Callable &&callable, const EventType &type, const EventFilter &filter )
+	{
+		return addThreadedListener( EventListener( std::forward<Callable>( callable ) ), type, filter );
+	}
+	//! Thread Safe counterpart of the keyed addListener().
+	bool addThreadedListener( const EventListenerDelegate &eventDelegate, const EventType &type, EventKey key )
+	{
+		return static_cast<bool>( addThreadedListener( EventListener( eventDelegate ), type, key ) );
+	}
+	template<typename Callable, typename = EnableIfListenerCallable<Callable>>
+	EventListenerHandle addThreadedListener( Callable &&callable, const EventType &type, EventKey key )
+	{
+		return addThreadedListener( EventListener( std::forward<Callable>( callable ) ), type, key );
+	}
+	EventListenerHandle addThreadedListener( const EventListener &listener, const EventType &type )
+	{
+		return addThreadedListener( listener, type, EventFilter(), NO_EVENT_KEY );
+	}
+	EventListenerHandle addThreadedListener( const EventListener &listener, const EventType &type, const EventFilter &filter )
+	{
+		return addThreadedListener( listener, type, filter, NO_EVENT_KEY );
+	}
+	EventListenerHandle addThreadedListener( const EventListener &listener, const EventType &type, EventKey key )
+	{
+		return addThreadedListener( listener, type, EventFilter(), key );
+	}
+	//! Registers \a listener for events of \a type that pass \a filter. If
+	//! \a key isn't NO_EVENT_KEY the listener only hears events whose
+	//! getEventKey() is \a key, and other keys' events never reach it.
+	virtual EventListenerHandle addThreadedListener( const EventListener &listener, const EventType &type, const EventFilter &filter, EventKey key ) = 0;
+	//! Thread Safe counterpart of addScopedListener().
+	ScopedListener addScopedThreadedListener( const EventListenerDelegate &eventDelegate, const EventType &type );
+	//! Thread Safe counterpart of rebindListener().
+	virtual bool rebindThreadedListener( const EventListenerHandle &handle, void *object ) = 0;
+	virtual bool setThreadedListenerFilter( const EventListenerHandle &handle, const EventFilter &filter ) = 0;
 	//! Removes a delegate / event type pairing from the internal tables. This
 	//! function removes in a Thread Safe manner. Returns false if the pairing
 	//! was not found.
 	virtual bool removeThreadedListener( const EventListenerDelegate &eventDelegate, const EventType &type ) = 0;
+	virtual bool removeThreadedListener( const EventListenerDelegate &eventDelegate, const EventType &type, EventKey key ) = 0;
+	virtual bool removeThreadedListener( const EventListenerHandle &handle ) = 0;
+	//! Thread Safe counterpart of removeAllListenersFor().
+	virtual size_t removeAllThreadedListenersFor( const void *owner ) = 0;
 	//! Fires off event NOW. NOTE: This function could be called from any thread.
 	//! This bypasses the queue entirely and immediately calls all delegate functions
 	//! registered to listen for this event.
 	virtual bool triggerThreadedEvent( const EventDataRef &event ) = 0;
 	virtual void removeAllThreadedListeners() = 0;
-};
\ No newline at end of file
+	
+protected:
+	//! Destroys the coroutines still suspended on this manager. Derived
+	//! managers call it first thing in their destructor, while their
+	//! listeners can still be removed.
+	void destroyPendingAwaiters();
+	
+private:
+#if defined( __cpp_impl_coroutine )
+	template<typename EventT, typename Predicate>
+	friend class EventAwaitable;
+#endif
+	
+	void addPendingAwaiter( EventAwaiter *awaiter ) { mPendingAwaiters.push_back( awaiter ); }
+	void removePendingAwaiter( EventAwaiter *awaiter );
+	
+	std::string					mName;
+	ClockFn						mClock;
+	std::vector<EventAwaiter*>	mPendingAwaiters;
+};
+
+//! Makes a manager the calling thread's current one for the scope's lifetime,
+//! e.g. while a subsystem constructs objects that register with
+//! EventManager::get(), then restores the previous one.
+class CurrentEventManagerScope {
+public:
+	explicit CurrentEventManagerScope( EventManagerBase *manager ) : mPrevious( EventManagerBase::setCurrent( manager ) ) {}
+	~CurrentEventManagerScope() { EventManagerBase::setCurrent( mPrevious ); }
+	
+	CurrentEventManagerScope( const CurrentEventManagerScope & ) = delete;
+	CurrentEventManagerScope& operator=( const CurrentEventManagerScope & ) = delete;
+	
+private:
+	EventManagerBase	*mPrevious;
+};
+
+//! Owns one delegate registration and removes it when destroyed. Moving the
+//! token hands the registration over without touching the manager; an object
+//! that owns its token and is itself moved calls rebind( this ) to point the
+//! existing slot at its new address, instead of a remove and add round trip.
+//! The manager must outlive the token.
+class ScopedListener {
+public:
+	ScopedListener() : mManager( nullptr ), mIsThreaded( false ) {}
+	ScopedListener( EventManagerBase *manager, const EventListenerHandle &handle, bool isThreaded = false )
+	: mManager( handle ? manager : nullptr ), mHandle( handle ), mIsThreaded( isThreaded ) {}
+	~ScopedListener() { reset(); }
+	
+	ScopedListener( const ScopedListener & ) = delete;
+	ScopedListener& operator=( const ScopedListener & ) = delete;
+	
+	ScopedListener( ScopedListener &&other ) noexcept
+	: mManager( other.mManager ), mHandle( other.mHandle ), mIsThreaded( other.mIsThreaded )
+	{
+		other.mManager = nullptr;
+		other.mHandle = EventListenerHandle();
+	}
+	ScopedListener& operator=( ScopedListener &&other ) noexcept
+	{
+		if( this != &other ) {
+			reset();
+			std::swap( mManager, other.mManager );
+			std::swap( mHandle, other.mHandle );
+			std::swap( mIsThreaded, other.mIsThreaded );
+		}
+		return *this;
+	}
+	
+	//! Points the registration at \a object in O(1). Returns false if the
+	//! token is empty or the registration is gone.
+	bool rebind( void *object )
+	{
+		if( ! mManager )
+			return false;
+		return mIsThreaded ? mManager->rebindThreadedListener( mHandle, object ) : mManager->rebindListener( mHandle, object );
+	}
+	//! Replaces the registration's filter in place.
+	bool setFilter( const EventFilter &filter )
+	{
+		if( ! mManager )
+			return false;
+		return mIsThreaded ? mManager->setThreadedListenerFilter( mHandle, filter ) : mManager->setListenerFilter( mHandle, filter );
+	}
+	//! Removes the registration now.
+	void reset()
+	{
+		if( ! mManager )
+			return;
+		if( mIsThreaded )
+			mManager->removeThreadedListener( mHandle );
+		else
+			mManager->removeListener( mHandle );
+		mManager = nullptr;
+		mHandle = EventListenerHandle();
+	}
+	//! Gives up ownership without removing the registration.
+	EventListenerHandle release()
+	{
+		auto handle = mHandle;
+		mManager = nullptr;
+		mHandle = EventListenerHandle();
+		return handle;
+	}
+	
+	const EventListenerHandle&	getHandle() const { return mHandle; }
+	explicit operator bool() const { return mManager != nullptr; }
+	
+private:
+	EventManagerBase	*mManager;
+	EventListenerHandle	mHandle;
+	bool				mIsThreaded;
+};
+
+inline ScopedListener EventManagerBase::addScopedListener( const EventListenerDelegate &eventDelegate, const EventType &type )
+{
+	return ScopedListener( this, addListener( EventListener( eventDelegate ), type ) );
+}
+
+inline ScopedListener EventManagerBase::addScopedListener( const EventListenerDelegate &eventDelegate, const EventType &type, const EventFilter &filter )
+{
+	return ScopedListener( this, addListener( EventListener( eventDelegate ), type, filter ) );
+}
+
+inline ScopedListener EventManagerBase::addScopedThreadedListener( const EventListenerDelegate &eventDelegate, const EventType &type )
+{
+	return ScopedListener( this, addThreadedListener( EventListener( eventDelegate ), type ), true );
+}
@@ -0,0 +1,324 @@
+//
+//  EventMetrics.cpp
+//  Cinder-EventManager
+//
+//
+
+#include "EventMetrics.h"
+
+#if defined( EVENT_MANAGER_ENABLE_METRICS )
+
+#include <algorithm>
+#include <map>
+#include <thread>
+
+using namespace std;
+
+namespace {
+
+const size_t kMaxEventTypes = EVENT_MANAGER_METRICS_MAX_EVENT_TYPES;
+const size_t kMaxListeners	= EVENT_MANAGER_METRICS_MAX_LISTENERS;
+
+// Every counter in a ThreadBlock has exactly one writer, so a relaxed load and
+// store is enough and avoids a locked read-modify-write on the hot path.
+inline void bump( atomic<uint64_t> &counter, uint64_t amount = 1 )
+{
+	counter.store( counter.load( memory_order_relaxed ) + amount, memory_order_relaxed );
+}
+
+inline size_t hashKey( uint64_t key )
+{
+	// splitmix64 finalizer, event types are often already hashes but listener
+	// keys are pointers with low bits clear.
+	key ^= key >> 30; key *= 0xbf58476d1ce4e5b9ull;
+	key ^= key >> 27; key *= 0x94d049bb133111ebull;
+	key ^= key >> 31;
+	return static_cast<size_t>( key );
+}
+
+struct AtomicHistogram {
+	AtomicHistogram()
+	{
+		for( auto &bucket : mBuckets )
+			bucket.store( 0, memory_order_relaxed );
+		mCount.store( 0, memory_order_relaxed );
+		mTotalNanos.store( 0, memory_order_relaxed );
+		mMaxNanos.store( 0, memory_order_relaxed );
+	}
+
+	void record( uint64_t nanos )
+	{
+		bump( mBuckets[EventLatencyHistogram::getBucketIndex( nanos )] );
+		bump( mCount );
+		bump( mTotalNanos, nanos );
+		if( nanos > mMaxNanos.load( memory_order_relaxed ) )
+			mMaxNanos.store( nanos, memory_order_relaxed );
+	}
+
+	void load( EventLatencyHistogram *histogram ) const
+	{
+		for( size_t i = 0; i < EventLatencyHistogram::kNumBuckets; ++i )
+			histogram->mBuckets[i] = mBuckets[i].load( memory_order_relaxed );
+		histogram->mCount = mCount.load( memory_order_relaxed );
+		histogram->mTotalNanos = mTotalNanos.load( memory_order_relaxed );
+		histogram->mMaxNanos = mMaxNanos.load( memory_order_relaxed );
+	}
+
+	array<atomic<uint64_t>, EventLatencyHistogram::kNumBuckets> mBuckets;
+	atomic<uint64_t>	mCount;
+	atomic<uint64_t>	mTotalNanos;
+	atomic<uint64_t>	mMaxNanos;
+};
+
+struct ListenerSlot {
+	ListenerSlot() : mType( 0 ), mListener( 0 ) { mIsUsed.store( false, memory_order_relaxed ); }
+
+	// mType and mListener are written once by the owning thread before
+	// mIsUsed is published, and only read by other threads after it is.
+	atomic<bool>	mIsUsed;
+	EventType		mType;
+	uint64_t		mListener;
+	AtomicHistogram	mLatency;
+};
+
+atomic<uint64_t> sNextMetricsId( 1 );
+
+} // anonymous namespace
+
+struct EventMetrics::TypeSlot {
+	TypeSlot() : mType( 0 )
+	{
+		mIsUsed.store( false, memory_order_relaxed );
+		mNumTriggered.store( 0, memory_order_relaxed );
+		mNumQueued.store( 0, memory_order_relaxed );
+		mNumDispatched.store( 0, memory_order_relaxed );
+		mNumOverflowed.store( 0, memory_order_relaxed );
+	}
+
+	atomic<bool>		mIsUsed;
+	EventType			mType;
+	atomic<uint64_t>	mNumTriggered;
+	atomic<uint64_t>	mNumQueued;
+	atomic<uint64_t>	mNumDispatched;
+	atomic<uint64_t>	mNumOverflowed;
+	AtomicHistogram		mQueueWait;
+};
+
+struct EventMetrics::ThreadBlock {
+	ThreadBlock() : mThread( this_thread::get_id() ) { mNumDropped.store( 0, memory_order_relaxed ); }
+
+	const thread::id				mThread;
+	array<TypeSlot, kMaxEventTypes>	mTypes;
+	array<ListenerSlot, kMaxListeners> mListeners;
+	atomic<uint64_t>				mNumDropped;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////
+// EventLatencyHistogram
+
+size_t EventLatencyHistogram::getBucketIndex( uint64_t nanos )
+{
+	if( nanos < 4 )
+		return static_cast<size_t>( nanos );
+	size_t msb = 63;
+	while( ! ( nanos >> msb ) )
+		--msb;
+	if( msb > 32 )
+		return kNumBuckets - 1;
+	size_t index = ( ( msb - 1 ) << 2 ) + static_cast<size_t>( ( nanos >> ( msb - 2 ) ) & 3 );
+	return std::min( index, kNumBuckets - 1 );
+}
+
+uint64_t EventLatencyHistogram::getBucketLowerBound( size_t index )
+{
+	if( index < 4 )
+		return index;
+	uint64_t msb = ( index >> 2 ) + 1;
+	uint64_t sub = index & 3;
+	return ( 4 + sub ) << ( msb - 2 );
+}
+
+uint64_t EventLatencyHistogram::getPercentileNanos( double percentile ) const
+{
+	if( ! mCount )
+		return 0;
+	uint64_t target = static_cast<uint64_t>( double( mCount ) * std::min( std::max( percentile, 0.0 ), 100.0 ) / 100.0 );
+	uint64_t seen = 0;
+	for( size_t i = 0; i < kNumBuckets; ++i ) {
+		seen += mBuckets[i];
+		if( seen > target || seen == mCount )
+			return getBucketLowerBound( i );
+	}
+	return mMaxNanos;
+}
+
+void EventLatencyHistogram::merge( const EventLatencyHistogram &other )
+{
+	for( size_t i = 0; i < kNumBuckets; ++i )
+		mBuckets[i] += other.mBuckets[i];
+	mCount += other.mCount;
+	mTotalNanos += other.mTotalNanos;
+	mMaxNanos = std::max( mMaxNanos, other.mMaxNanos );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+// EventMetrics
+
+EventMetrics::EventMetrics()
+: mId( sNextMetricsId.fetch_add( 1 ) )
+{
+}
+
+EventMetrics::~EventMetrics()
+{
+}
+
+EventMetrics::ThreadBlock* EventMetrics::getThreadBlock()
+{
+	// A thread usually records into one or two managers, so a tiny cache keyed
+	// by the metrics' unique id (never its address, which may be reused) avoids
+	// taking the registration lock after the first sample.
+	struct CacheEntry { uint64_t mId; ThreadBlock *mBlock; };
+	static thread_local array<CacheEntry, 4> sCache = {};
+	static thread_local size_t sNextCacheEntry = 0;
+
+	for( auto &entry : sCache ) {
+		if( entry.mId == mId )
+			return entry.mBlock;
+	}
+
+	ThreadBlock *block = nullptr;
+	{
+		lock_guard<mutex> lock( mBlocksMutex );
+		auto thisThread = this_thread::get_id();
+		for( auto &existing : mBlocks ) {
+			if( existing->mThread == thisThread ) {
+				block = existing.get();
+				break;
+			}
+		}
+		if( ! block ) {
+			mBlocks.emplace_back( new ThreadBlock );
+			block = mBlocks.back().get();
+		}
+	}
+	sCache[sNextCacheEntry] = { mId, block };
+	sNextCacheEntry = ( sNextCacheEntry + 1 ) % sCache.size();
+	return block;
+}
+
+EventMetrics::TypeSlot* EventMetrics::findTypeSlot( ThreadBlock *block, EventType type )
+{
+	size_t start = hashKey( type );
+	for( size_t probe = 0; probe < kMaxEventTypes; ++probe ) {
+		auto &slot = block->mTypes[( start + probe ) % kMaxEventTypes];
+		if( ! slot.mIsUsed.load( memory_order_relaxed ) ) {
+			slot.mType = type;
+			slot.mIsUsed.store( true, memory_order_release );
+			return &slot;
+		}
+		if( slot.mType == type )
+			return &slot;
+	}
+	bump( block->mNumDropped );
+	return nullptr;
+}
+
+void EventMetrics::recordTriggered( EventType type )
+{
+	if( auto slot = findTypeSlot( getThreadBlock(), type ) )
+		bump( slot->mNumTriggered );
+}
+
+void EventMetrics::recordQueued( EventType type )
+{
+	if( auto slot = findTypeSlot( getThreadBlock(), type ) )
+		bump( slot->mNumQueued );
+}
+
+void EventMetrics::recordOverflowed( EventType type )
+{
+	if( auto slot = findTypeSlot( getThreadBlock(), type ) )
+		bump( slot->mNumOverflowed );
+}
+
+void EventMetrics::recordDispatched( EventType type, double queueWaitSeconds )
+{
+	if( auto slot = findTypeSlot( getThreadBlock(), type ) ) {
+		bump( slot->mNumDispatched );
+		if( queueWaitSeconds >= 0.0 )
+			slot->mQueueWait.record( static_cast<uint64_t>( queueWaitSeconds * 1e9 ) );
+	}
+}
+
+void EventMetrics::recordListener( EventType type, uint64_t listener, uint64_t nanos )
+{
+	auto block = getThreadBlock();
+	size_t start = hashKey( type ^ hashKey( listener ) );
+	for( size_t probe = 0; probe < kMaxListeners; ++probe ) {
+		auto &slot = block->mListeners[( start + probe ) % kMaxListeners];
+		if( ! slot.mIsUsed.load( memory_order_relaxed ) ) {
+			slot.mType = type;
+			slot.mListener = listener;
+			slot.mIsUsed.store( true, memory_order_release );
+		}
+		else if( slot.mType != type || slot.mListener != listener )
+			continue;
+		slot.mLatency.record( nanos );
+		return;
+	}
+	bump( block->mNumDropped );
+}
+
+EventMetricsSnapshot EventMetrics::snapshot() const
+{
+	map<EventType, EventTypeMetrics> types;
+	map<pair<EventType, uint64_t>, ListenerMetrics> listeners;
+	EventMetricsSnapshot result;
+	result.mNumDropped = 0;
+
+	lock_guard<mutex> lock( mBlocksMutex );
+	for( auto &block : mBlocks ) {
+		for( auto &slot : block->mTypes ) {
+			if( ! slot.mIsUsed.load( memory_order_acquire ) )
+				continue;
+			auto inserted = types.emplace( slot.mType, EventTypeMetrics() );
+			auto &metrics = inserted.first->second;
+			if( inserted.second ) {
+				metrics.mType = slot.mType;
+				metrics.mNumTriggered = metrics.mNumQueued = metrics.mNumDispatched = metrics.mNumOverflowed = 0;
+			}
+			metrics.mNumTriggered += slot.mNumTriggered.load( memory_order_relaxed );
+			metrics.mNumQueued += slot.mNumQueued.load( memory_order_relaxed );
+			metrics.mNumDispatched += slot.mNumDispatched.load( memory_order_relaxed );
+			metrics.mNumOverflowed += slot.mNumOverflowed.load( memory_order_relaxed );
+			EventLatencyHistogram wait;
+			slot.mQueueWait.load( &wait );
+			metrics.mQueueWait.merge( wait );
+		}
+		for( auto &slot : block->mListeners ) {
+			if( ! slot.mIsUsed.load( memory_order_acquire ) )
+				continue;
+			auto inserted = listeners.emplace( make_pair( slot.mType, slot.mListener ), ListenerMetrics() );
+			auto &metrics = inserted.first->second;
+			if( inserted.second ) {
+				metrics.mType = slot.mType;
+				metrics.mListener = slot.mListener;
+			}
+			EventLatencyHistogram latency;
+			slot.mLatency.load( &latency );
+			metrics.mLatency.merge( latency );
+		}
+		result.mNumDropped += block->mNumDropped.load( memory_order_relaxed );
+	}
+
+	result.mEventTypes.reserve( types.size() );
+	for( auto &type : types )
+		result.mEventTypes.push_back( type.second );
+	result.mListeners.reserve( listeners.size() );
+	for( auto &listener : listeners )
+		result.mListeners.push_back( listener.second );
+	return result;
+}
+
+#endif
@@ -0,0 +1,114 @@
+//
+//  EventMetrics.h
+//  Cinder-EventManager
+//
+//
+
+#pragma once
+
+// Dispatch instrumentation is opt-in. Unless EVENT_MANAGER_ENABLE_METRICS is
+// defined none of this is compiled and the EventManager carries no extra state
+// or work on its hot paths.
+#if defined( EVENT_MANAGER_ENABLE_METRICS )
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "BaseEventData.h"
+
+//! Per-thread table sizes. Types or listeners beyond these are counted as
+//! dropped rather than recorded.
+#if ! defined( EVENT_MANAGER_METRICS_MAX_EVENT_TYPES )
+	#define EVENT_MANAGER_METRICS_MAX_EVENT_TYPES 64
+#endif
+#if ! defined( EVENT_MANAGER_METRICS_MAX_LISTENERS )
+	#define EVENT_MANAGER_METRICS_MAX_LISTENERS 256
+#endif
+
+//! A log-linear (HDR-style) latency histogram in nanoseconds. Each power of two
+//! is split into four linear sub-buckets, so any recorded value is reported
+//! within 25% of its true value, up to ~4.3 seconds.
+struct EventLatencyHistogram {
+	static const size_t kNumBuckets = 128;
+
+	EventLatencyHistogram() : mCount( 0 ), mTotalNanos( 0 ), mMaxNanos( 0 ) { mBuckets.fill( 0 ); }
+
+	static size_t	getBucketIndex( uint64_t nanos );
+	static uint64_t	getBucketLowerBound( size_t index );
+
+	//! Returns the lower bound of the bucket containing the given percentile
+	//! (0 - 100) of recorded values.
+	uint64_t	getPercentileNanos( double percentile ) const;
+	double		getMeanNanos() const { return mCount ? double( mTotalNanos ) / double( mCount ) : 0.0; }
+	void		merge( const EventLatencyHistogram &other );
+
+	std::array<uint64_t, kNumBuckets>	mBuckets;
+	uint64_t							mCount;
+	uint64_t							mTotalNanos;
+	uint64_t							mMaxNanos;
+};
+
+struct EventTypeMetrics {
+	EventType				mType;
+	uint64_t				mNumTriggered;
+	uint64_t				mNumQueued;
+	uint64_t				mNumDispatched;
+	//! Events of this type a full queue rejected, dropped or coalesced away.
+	uint64_t				mNumOverflowed;
+	//! Time between the event's timestamp and its dispatch from update().
+	//! Events with a zero timestamp are not stamped and are not recorded here.
+	EventLatencyHistogram	mQueueWait;
+};
+
+struct ListenerMetrics {
+	EventType				mType;
+	//! Identifies the listener within its event type.
+	uint64_t				mListener;
+	EventLatencyHistogram	mLatency;
+};
+
+struct EventMetricsSnapshot {
+	std::vector<EventTypeMetrics>	mEventTypes;
+	std::vector<ListenerMetrics>	mListeners;
+	//! Number of samples that did not fit in the per-thread tables.
+	uint64_t						mNumDropped;
+};
+
+//! Collects per event type and per listener dispatch statistics. Every thread
+//! that records gets its own fixed-size block which only it writes to, so
+//! recording never locks or contends. snapshot() merges all blocks and may be
+//! called from any thread at any time.
+class EventMetrics {
+public:
+	EventMetrics();
+	~EventMetrics();
+
+	EventMetrics( const EventMetrics & ) = delete;
+	EventMetrics& operator=( const EventMetrics & ) = delete;
+
+	void recordTriggered( EventType type );
+	void recordQueued( EventType type );
+	void recordOverflowed( EventType type );
+	//! Pass a negative \a queueWaitSeconds for events that weren't stamped.
+	void recordDispatched( EventType type, double queueWaitSeconds );
+	void recordListener( EventType type, uint64_t listener, uint64_t nanos );
+
+	EventMetricsSnapshot snapshot() const;
+
+private:
+	struct ThreadBlock;
+	struct TypeSlot;
+
+	ThreadBlock*	getThreadBlock();
+	TypeSlot*		findTypeSlot( ThreadBlock *block, EventType type );
+
+	const uint64_t								mId;
+	mutable std::mutex							mBlocksMutex;
+	std::vector<std::unique_ptr<ThreadBlock>>	mBlocks;
+};
+
+#endif
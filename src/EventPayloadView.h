@@ -0,0 +1,100 @@
+//
+//  EventPayloadView.h
+//  Cinder-EventManager
+//
+//
+
+#pragma once
+
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "EventConfig.h"
+
+//! A read-only, refcounted window into a serialized receive or journal buffer.
+//! Copying a view only bumps the refcount of the buffer that owns the bytes, so
+//! events carrying large blobs (point clouds, image tiles) can be forwarded,
+//! filtered and re-queued without ever copying their payload.
+class EventPayloadView {
+public:
+	EventPayloadView() : mData( nullptr ), mSize( 0 ) {}
+	//! Views the whole of \a buffer, keeping it alive for the lifetime of the view.
+	explicit EventPayloadView( const std::shared_ptr<const EventBuffer> &buffer )
+	: mOwner( buffer ),
+		mData( buffer ? static_cast<const uint8_t*>( buffer->getData() ) : nullptr ),
+		mSize( buffer ? buffer->getSize() : 0 ) {}
+	//! Views \a size bytes at \a data. \a owner is whatever keeps those bytes alive.
+	EventPayloadView( std::shared_ptr<const void> owner, const void *data, size_t size )
+	: mOwner( std::move( owner ) ), mData( static_cast<const uint8_t*>( data ) ), mSize( size ) {}
+
+	const uint8_t*	getData() const { return mData; }
+	size_t			getSize() const { return mSize; }
+	bool			empty() const { return mSize == 0; }
+
+	//! Returns a view of \a size bytes starting at \a offset that shares this
+	//! view's owner. The range is clamped to the bounds of this view.
+	EventPayloadView subView( size_t offset, size_t size ) const
+	{
+		if( offset > mSize )
+			offset = mSize;
+		if( size > mSize - offset )
+			size = mSize - offset;
+		return EventPayloadView( mOwner, mData + offset, size );
+	}
+
+	//! Decodes a trivially copyable value at \a offset. Returns false, leaving
+	//! \a value untouched, if the value would run past the end of the view.
+	template<typename T>
+	bool read( size_t offset, T *value ) const
+	{
+		static_assert( std::is_trivially_copyable<T>::value, "EventPayloadView can only decode trivially copyable types" );
+		if( offset > mSize || sizeof( T ) > mSize - offset )
+			return false;
+		std::memcpy( value, mData + offset, sizeof( T ) );
+		return true;
+	}
+
+	//! Wraps the viewed bytes in a non-owning EventBuffer so that events which
+	//! only implement deSerialize( const EventBuffer& ) can read them in place.
+	//! The returned buffer must not outlive this view.
+	EventBuffer asBuffer() const { return EventBuffer( const_cast<uint8_t*>( mData ), mSize ); }
+
+	const std::shared_ptr<const void>& getOwner() const { return mOwner; }
+
+private:
+	std::shared_ptr<const void>	mOwner;
+	const uint8_t*				mData;
+	size_t						mSize;
+};
+
+//! A field of a view-backed event that is decoded from the payload on first
+//! access and cached afterwards. Events that never touch a field never pay to
+//! decode it.
+template<typename T>
+class LazyPayloadField {
+public:
+	explicit LazyPayloadField( size_t offset = 0 ) : mOffset( offset ), mValue(), mIsDecoded( false ) {}
+
+	//! Returns the decoded value, decoding it from \a payload if this is the
+	//! first access. Out of range fields decode to a value-initialized T.
+	const T& get( const EventPayloadView &payload ) const
+	{
+		if( ! mIsDecoded ) {
+			payload.read( mOffset, &mValue );
+			mIsDecoded = true;
+		}
+		return mValue;
+	}
+	//! Overrides the payload's value, for instance when a filter rewrites a field.
+	void set( const T &value ) { mValue = value; mIsDecoded = true; }
+
+	bool	isDecoded() const { return mIsDecoded; }
+	size_t	getOffset() const { return mOffset; }
+
+private:
+	size_t		mOffset;
+	mutable T	mValue;
+	mutable bool mIsDecoded;
+};
@@ -0,0 +1,110 @@
+//
+//  EventRequests.cpp
+//  Cinder-EventManager
+//
+//
+
+#include "EventRequests.h"
+
+using namespace std;
+
+uint64_t EventRequestTable::open( EventType replyType, double deadline )
+{
+	lock_guard<mutex> lock( mMutex );
+	uint32_t index;
+	if( ! mFreeSlots.empty() ) {
+		index = mFreeSlots.back();
+		mFreeSlots.pop_back();
+	}
+	else {
+		index = static_cast<uint32_t>( mSlots.size() );
+		mSlots.emplace_back();
+	}
+	auto &slot = mSlots[index];
+	slot.mIsOpen = true;
+	slot.mReplyType = replyType;
+	slot.mDeadline = deadline;
+	// Ids pack the slot's generation in the high word and its index + 1 in
+	// the low word, so 0 is never a valid id.
+	return ( uint64_t( slot.mGeneration ) << 32 ) | ( uint64_t( index ) + 1 );
+}
+
+EventRequestTable::Slot* EventRequestTable::find( uint64_t id )
+{
+	uint32_t index = getSlotIndex( id );
+	if( ! id || index >= mSlots.size() )
+		return nullptr;
+	auto &slot = mSlots[index];
+	return slot.mIsOpen && slot.mGeneration == uint32_t( id >> 32 ) ? &slot : nullptr;
+}
+
+void EventRequestTable::free( Slot &slot, uint32_t index )
+{
+	slot.mIsOpen = false;
+	slot.mReply.reset();
+	++slot.mGeneration;
+	mFreeSlots.push_back( index );
+}
+
+bool EventRequestTable::resolve( uint64_t id, const EventDataRef &reply, double now )
+{
+	if( ! id )
+		return false;
+	lock_guard<mutex> lock( mMutex );
+	auto slot = find( id );
+	// Only the first reply counts, and none once the request timed out.
+	if( ! slot || slot->mReply || reply->getEventType() != slot->mReplyType || slot->mDeadline < 0.0 || now >= slot->mDeadline )
+		return false;
+	slot->mReply = reply;
+	return true;
+}
+
+bool EventRequestTable::isAwaiting( uint64_t id, EventType replyType )
+{
+	if( ! id )
+		return false;
+	lock_guard<mutex> lock( mMutex );
+	auto slot = find( id );
+	return slot && ! slot->mReply && slot->mReplyType == replyType && slot->mDeadline >= 0.0;
+}
+
+EventRequestTable::Status EventRequestTable::poll( uint64_t id, double now )
+{
+	lock_guard<mutex> lock( mMutex );
+	auto slot = find( id );
+	if( ! slot )
+		return Status::INVALID;
+	if( slot->mReply )
+		return Status::READY;
+	// A negative deadline marks a timed out request, so a reply that turns
+	// up late can't resolve it.
+	if( slot->mDeadline < 0.0 || now >= slot->mDeadline ) {
+		slot->mDeadline = -1.0;
+		return Status::TIMED_OUT;
+	}
+	return Status::PENDING;
+}
+
+EventDataRef EventRequestTable::take( uint64_t id )
+{
+	lock_guard<mutex> lock( mMutex );
+	auto slot = find( id );
+	if( ! slot || ! slot->mReply )
+		return nullptr;
+	auto reply = std::move( slot->mReply );
+	free( *slot, getSlotIndex( id ) );
+	return reply;
+}
+
+void EventRequestTable::close( uint64_t id )
+{
+	lock_guard<mutex> lock( mMutex );
+	if( auto slot = find( id ) )
+		free( *slot, getSlotIndex( id ) );
+}
+
+size_t EventRequestTable::size() const
+{
+	lock_guard<mutex> lock( mMutex );
+	return mSlots.size() - mFreeSlots.size();
+}
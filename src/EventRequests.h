@@ -0,0 +1,130 @@
+//
+//  EventRequests.h
+//  Cinder-EventManager
+//
+//
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "EventManagerBase.h"
+
+//! The requests an EventManager is waiting on replies for, keyed by the
+//! correlation id the request and its reply carry. Slots and their ids are
+//! recycled like listener handles, so once the table has grown to the number
+//! of requests in flight, opening and resolving them doesn't allocate.
+//! Thread Safe, since replies may be dispatched to threaded listeners.
+class EventRequestTable {
+public:
+	enum class Status { PENDING, READY, TIMED_OUT, INVALID };
+
+	EventRequestTable() = default;
+	EventRequestTable( const EventRequestTable & ) = delete;
+	EventRequestTable& operator=( const EventRequestTable & ) = delete;
+
+	//! Returns a new correlation id, never 0, for a request answered by an
+	//! event of \a replyType. It times out at \a deadline seconds on the
+	//! manager's clock.
+	uint64_t	open( EventType replyType, double deadline );
+	//! Stores \a reply as the response to request \a id, if it's still
+	//! pending at time \a now and \a reply is of the type it waits for.
+	//! Returns false otherwise, e.g. for the request event itself.
+	bool		resolve( uint64_t id, const EventDataRef &reply, double now );
+	//! True if request \a id is still waiting for a reply of \a replyType, so
+	//! such a reply is worth queueing even without listeners of its own.
+	bool		isAwaiting( uint64_t id, EventType replyType );
+	//! Returns the status of request \a id at time \a now, timing it out if
+	//! its deadline has passed.
+	Status		poll( uint64_t id, double now );
+	//! Returns the reply to request \a id, or nullptr if there is none yet.
+	//! The id is closed once its reply has been taken.
+	EventDataRef take( uint64_t id );
+	//! Forgets request \a id; a later reply is ignored.
+	void		close( uint64_t id );
+	//! Requests still open, replied to or not.
+	size_t		size() const;
+
+private:
+	struct Slot {
+		uint32_t		mGeneration = 0;
+		bool			mIsOpen = false;
+		EventType		mReplyType = 0;
+		double			mDeadline = 0.0;
+		EventDataRef	mReply;
+	};
+
+	static uint32_t	getSlotIndex( uint64_t id ) { return static_cast<uint32_t>( id & 0xffffffffu ) - 1; }
+	//! Returns the open slot with \a id, or nullptr. mMutex must be held.
+	Slot*			find( uint64_t id );
+	void			free( Slot &slot, uint32_t index );
+
+	mutable std::mutex		mMutex;
+	std::vector<Slot>		mSlots;
+	std::vector<uint32_t>	mFreeSlots;
+};
+
+//! The caller's side of EventManager::request(): the reply of type Resp to
+//! one request, once it has been dispatched. Futures don't block; poll them,
+//! e.g. once per frame, with isReady() or getStatus(). Move only. Destroying
+//! or cancel()ing a future forgets its request, and it must not outlive the
+//! manager it came from.
+template<typename Resp>
+class EventFuture {
+public:
+	using Status = EventRequestTable::Status;
+
+	EventFuture() : mRequests( nullptr ), mClock( nullptr ), mId( 0 ) {}
+	EventFuture( EventRequestTable *requests, EventManagerBase::ClockFn clock, uint64_t id ) : mRequests( requests ), mClock( clock ), mId( id ) {}
+	~EventFuture() { cancel(); }
+
+	EventFuture( EventFuture &&other ) : mRequests( other.mRequests ), mClock( other.mClock ), mId( other.mId ) { other.mId = 0; }
+	EventFuture& operator=( EventFuture &&other )
+	{
+		if( this != &other ) {
+			cancel();
+			mRequests = other.mRequests;
+			mClock = other.mClock;
+			mId = other.mId;
+			other.mId = 0;
+		}
+		return *this;
+	}
+	EventFuture( const EventFuture & ) = delete;
+	EventFuture& operator=( const EventFuture & ) = delete;
+
+	//! False for default constructed futures and once the reply was taken.
+	bool		valid() const { return mId != 0; }
+	//! The correlation id shared by the request and its reply.
+	uint64_t	getCorrelationId() const { return mId; }
+	Status		getStatus() const { return mId ? mRequests->poll( mId, mClock() ) : Status::INVALID; }
+	bool		isReady() const { return getStatus() == Status::READY; }
+	bool		isTimedOut() const { return getStatus() == Status::TIMED_OUT; }
+
+	//! Returns the reply and invalidates the future, or returns nullptr while
+	//! there is no reply yet. Timed out requests never get one.
+	std::shared_ptr<Resp> get()
+	{
+		if( ! mId )
+			return nullptr;
+		auto reply = mRequests->take( mId );
+		if( ! reply )
+			return nullptr;
+		mId = 0;
+		return std::dynamic_pointer_cast<Resp>( reply );
+	}
+	void cancel()
+	{
+		if( mId )
+			mRequests->close( mId );
+		mId = 0;
+	}
+
+private:
+	EventRequestTable			*mRequests;
+	EventManagerBase::ClockFn	mClock;
+	uint64_t					mId;
+};
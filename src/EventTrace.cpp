@@ -0,0 +1,236 @@
+//
+//  EventTrace.cpp
+//  Cinder-EventManager
+//
+//
+
+#include "EventTrace.h"
+
+#if defined( EVENT_MANAGER_ENABLE_TRACING )
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+const size_t kBufferSize = EVENT_MANAGER_TRACE_BUFFER_SIZE;
+
+struct Span {
+	const char			*mName;
+	uint64_t			mArg;
+	uint64_t			mBegin;
+	uint64_t			mEnd;
+	EventTrace::Category mCategory;
+};
+
+// One ring buffer entry, guarded by its own sequence lock so the exporter can
+// read it while the owning thread may be overwriting it. mSequence is odd
+// while the span with index ( mSequence - 1 ) / 2 is being written, and
+// 2 * ( index + 1 ) once it's complete. The fields are atomics only so that
+// reading a torn span is well defined; they're written and read relaxed.
+struct SpanSlot {
+	atomic<uint64_t>		mSequence{ 0 };
+	atomic<const char*>		mName{ nullptr };
+	atomic<uint64_t>		mArg{ 0 };
+	atomic<uint64_t>		mBegin{ 0 };
+	atomic<uint64_t>		mEnd{ 0 };
+	atomic<uint8_t>			mCategory{ 0 };
+};
+
+struct ThreadBuffer {
+	explicit ThreadBuffer( uint32_t id ) : mId( id ), mSpans( new SpanSlot[kBufferSize] ) { mHead.store( 0, memory_order_relaxed ); }
+
+	// Copies the span with \a index into \a span. Returns false if it has been
+	// overwritten, or is being overwritten, by a later span.
+	bool read( uint64_t index, Span &span ) const
+	{
+		const auto &slot = mSpans[index % kBufferSize];
+		const auto sequence = slot.mSequence.load( memory_order_acquire );
+		if( sequence != 2 * ( index + 1 ) )
+			return false;
+		span.mName = slot.mName.load( memory_order_relaxed );
+		span.mArg = slot.mArg.load( memory_order_relaxed );
+		span.mBegin = slot.mBegin.load( memory_order_relaxed );
+		span.mEnd = slot.mEnd.load( memory_order_relaxed );
+		span.mCategory = static_cast<EventTrace::Category>( slot.mCategory.load( memory_order_relaxed ) );
+		atomic_thread_fence( memory_order_acquire );
+		return slot.mSequence.load( memory_order_relaxed ) == sequence;
+	}
+
+	const uint32_t			mId;
+	unique_ptr<SpanSlot[]>	mSpans;
+	// Total spans ever written. Only the owning thread stores to it.
+	atomic<uint64_t>		mHead;
+	// Guarded by the registry mutex.
+	string					mName;
+	uint64_t				mClearedAt = 0;
+};
+
+// Buffers outlive their threads so spans recorded by short lived workers
+// still make it into the dump.
+struct Registry {
+	mutex								mMutex;
+	vector<shared_ptr<ThreadBuffer>>	mBuffers;
+	atomic<bool>						mIsEnabled{ true };
+	const chrono::steady_clock::time_point mEpoch = chrono::steady_clock::now();
+};
+
+Registry& getRegistry()
+{
+	static Registry sRegistry;
+	return sRegistry;
+}
+
+ThreadBuffer& getThreadBuffer()
+{
+	static thread_local shared_ptr<ThreadBuffer> sBuffer;
+	if( ! sBuffer ) {
+		auto &registry = getRegistry();
+		lock_guard<mutex> lock( registry.mMutex );
+		sBuffer = make_shared<ThreadBuffer>( static_cast<uint32_t>( registry.mBuffers.size() + 1 ) );
+		registry.mBuffers.push_back( sBuffer );
+	}
+	return *sBuffer;
+}
+
+const char* getCategoryName( EventTrace::Category category )
+{
+	static const array<const char*, EventTrace::NUM_CATEGORIES> sNames = { { "update", "event", "listener" } };
+	return category < EventTrace::NUM_CATEGORIES ? sNames[category] : "unknown";
+}
+
+void writeJsonString( ostream &stream, const char *str )
+{
+	stream << '"';
+	for( ; str && *str; ++str ) {
+		char c = *str;
+		if( c == '"' || c == '\\' )
+			stream << '\\' << c;
+		else if( static_cast<unsigned char>( c ) < 0x20 )
+			stream << ' ';
+		else
+			stream << c;
+	}
+	stream << '"';
+}
+
+// Chrome trace timestamps are in microseconds, keep nanosecond precision.
+void writeMicros( ostream &stream, uint64_t nanos )
+{
+	auto fraction = nanos % 1000;
+	stream << nanos / 1000 << '.' << char( '0' + fraction / 100 ) << char( '0' + fraction / 10 % 10 ) << char( '0' + fraction % 10 );
+}
+
+} // anonymous namespace
+
+uint64_t EventTrace::now()
+{
+	return static_cast<uint64_t>( chrono::duration_cast<chrono::nanoseconds>( chrono::steady_clock::now() - getRegistry().mEpoch ).count() );
+}
+
+void EventTrace::record( const char *name, Category category, uint64_t arg, uint64_t beginNanos, uint64_t endNanos )
+{
+	if( ! getRegistry().mIsEnabled.load( memory_order_relaxed ) )
+		return;
+	auto &buffer = getThreadBuffer();
+	auto head = buffer.mHead.load( memory_order_relaxed );
+	auto &slot = buffer.mSpans[head % kBufferSize];
+	slot.mSequence.store( 2 * head + 1, memory_order_relaxed );
+	atomic_thread_fence( memory_order_release );
+	slot.mName.store( name, memory_order_relaxed );
+	slot.mArg.store( arg, memory_order_relaxed );
+	slot.mBegin.store( beginNanos, memory_order_relaxed );
+	slot.mEnd.store( endNanos, memory_order_relaxed );
+	slot.mCategory.store( category, memory_order_relaxed );
+	slot.mSequence.store( 2 * ( head + 1 ), memory_order_release );
+	buffer.mHead.store( head + 1, memory_order_release );
+}
+
+void EventTrace::setThreadName( const std::string &name )
+{
+	auto &buffer = getThreadBuffer();
+	lock_guard<mutex> lock( getRegistry().mMutex );
+	buffer.mName = name;
+}
+
+void EventTrace::setEnabled( bool enabled )
+{
+	getRegistry().mIsEnabled.store( enabled );
+}
+
+bool EventTrace::isEnabled()
+{
+	return getRegistry().mIsEnabled.load();
+}
+
+void EventTrace::writeChromeTrace( std::ostream &stream )
+{
+	auto &registry = getRegistry();
+	lock_guard<mutex> lock( registry.mMutex );
+
+	stream << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+	bool first = true;
+	vector<Span> spans;
+	for( auto &buffer : registry.mBuffers ) {
+		if( ! buffer->mName.empty() ) {
+			stream << ( first ? "" : "," ) << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->mId << ",\"args\":{\"name\":";
+			writeJsonString( stream, buffer->mName.c_str() );
+			stream << "}}";
+			first = false;
+		}
+
+		// Copy out the live window. The owning thread keeps recording, so each
+		// slot's sequence is checked to drop spans overwritten mid-copy.
+		auto head = buffer->mHead.load( memory_order_acquire );
+		auto tail = std::max<uint64_t>( head > kBufferSize ? head - kBufferSize : 0, std::min( buffer->mClearedAt, head ) );
+		spans.clear();
+		Span copied;
+		for( auto i = tail; i < head; ++i ) {
+			if( buffer->read( i, copied ) )
+				spans.push_back( copied );
+		}
+
+		for( const auto &span : spans ) {
+			stream << ( first ? "" : "," ) << "\n{\"name\":";
+			writeJsonString( stream, span.mName );
+			stream << ",\"cat\":\"" << getCategoryName( span.mCategory ) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->mId
+				<< ",\"ts\":";
+			writeMicros( stream, span.mBegin );
+			stream << ",\"dur\":";
+			writeMicros( stream, span.mEnd - span.mBegin );
+			stream << ",\"args\":{\"arg\":" << span.mArg << "}}";
+			first = false;
+		}
+	}
+	stream << "\n]}\n";
+}
+
+bool EventTrace::dumpChromeTrace( const std::string &path )
+{
+	ofstream file( path );
+	if( ! file )
+		return false;
+	writeChromeTrace( file );
+	return static_cast<bool>( file );
+}
+
+void EventTrace::clear()
+{
+	// Only the owning thread may write its head, so clearing resets nothing
+	// in place; it advances a per-buffer watermark instead.
+	auto &registry = getRegistry();
+	lock_guard<mutex> lock( registry.mMutex );
+	for( auto &buffer : registry.mBuffers )
+		buffer->mClearedAt = buffer->mHead.load( memory_order_acquire );
+}
+
+#endif
@@ -0,0 +1,76 @@
+//
+//  EventTrace.h
+//  Cinder-EventManager
+//
+//
+
+#pragma once
+
+// Dispatch tracing is opt-in. Unless EVENT_MANAGER_ENABLE_TRACING is defined
+// the TRACE_EVENT_SCOPE hooks in the EventManager compile to nothing.
+#if defined( EVENT_MANAGER_ENABLE_TRACING )
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+//! Number of spans each thread keeps. Older spans are overwritten.
+#if ! defined( EVENT_MANAGER_TRACE_BUFFER_SIZE )
+	#define EVENT_MANAGER_TRACE_BUFFER_SIZE 16384
+#endif
+
+//! Records begin/end spans into per-thread ring buffers and writes them out in
+//! the Chrome trace event format, for chrome://tracing or ui.perfetto.dev.
+//! Recording never locks; each thread only ever writes its own buffer.
+class EventTrace {
+public:
+	enum Category : uint8_t { UPDATE, EVENT, LISTENER, NUM_CATEGORIES };
+
+	//! Appends a completed span. \a name must outlive the trace, which in
+	//! practice means a string literal or an EventData::getName().
+	static void record( const char *name, Category category, uint64_t arg, uint64_t beginNanos, uint64_t endNanos );
+	//! Nanoseconds since the trace epoch.
+	static uint64_t now();
+
+	//! Names the calling thread in the exported trace.
+	static void setThreadName( const std::string &name );
+	//! Enables or disables recording at runtime. Enabled by default.
+	static void setEnabled( bool enabled );
+	static bool isEnabled();
+
+	//! Writes every thread's buffered spans as Chrome trace JSON. Spans that are
+	//! overwritten while writing are skipped.
+	static void writeChromeTrace( std::ostream &stream );
+	//! Convenience for writeChromeTrace() to a file. Returns false on failure.
+	static bool dumpChromeTrace( const std::string &path );
+	//! Discards all buffered spans.
+	static void clear();
+};
+
+//! Records a span covering its own lifetime.
+class EventTraceScope {
+public:
+	EventTraceScope( const char *name, EventTrace::Category category, uint64_t arg = 0 )
+	: mName( name ), mCategory( category ), mArg( arg ), mBegin( EventTrace::now() ) {}
+	~EventTraceScope() { EventTrace::record( mName, mCategory, mArg, mBegin, EventTrace::now() ); }
+
+	EventTraceScope( const EventTraceScope & ) = delete;
+	EventTraceScope& operator=( const EventTraceScope & ) = delete;
+
+private:
+	const char				*mName;
+	EventTrace::Category	mCategory;
+	uint64_t				mArg;
+	uint64_t				mBegin;
+};
+
+#define EVENT_TRACE_CONCAT_IMPL( a, b )	a##b
+#define EVENT_TRACE_CONCAT( a, b )		EVENT_TRACE_CONCAT_IMPL( a, b )
+#define TRACE_EVENT_SCOPE( name, category, arg ) \
+	EventTraceScope EVENT_TRACE_CONCAT( eventTraceScope, __LINE__ )( name, EventTrace::category, arg )
+
+#else
+
+#define TRACE_EVENT_SCOPE( name, category, arg )	((void)0)
+
+#endif
@@ -0,0 +1,83 @@
+//
+//  DelegateTests.cpp
+//  Cinder-EventManager
+//
+//
+
+#include <unordered_set>
+
+#include "Delegate.h"
+#include "TestSupport.h"
+
+namespace {
+
+using IntDelegate = Delegate<int( int )>;
+
+struct Adder {
+	int add( int value ) { return value + mOffset; }
+	int sub( int value ) { return value - mOffset; }
+	int peek( int value ) const { return value * mOffset; }
+	int mOffset;
+};
+
+int twice( int value ) { return value * 2; }
+int thrice( int value ) { return value * 3; }
+
+} // anonymous namespace
+
+EVENT_TEST( DelegatesCallWhatTheyBind )
+{
+	Adder adder = { 10 };
+	const Adder &constAdder = adder;
+	CHECK_EQ( ( IntDelegate::create<Adder, &Adder::add>( &adder ) )( 1 ), 11 );
+	CHECK_EQ( ( IntDelegate::create<Adder, &Adder::peek>( &constAdder ) )( 2 ), 20 );
+	CHECK_EQ( IntDelegate::create<&twice>()( 4 ), 8 );
+	CHECK( IntDelegate().empty() );
+	CHECK( ! IntDelegate() );
+}
+
+EVENT_TEST( DelegatesCompareByObjectAndFunction )
+{
+	Adder a = { 1 }, b = { 1 };
+	auto aAdd = IntDelegate::create<Adder, &Adder::add>( &a );
+	CHECK( aAdd == ( IntDelegate::create<Adder, &Adder::add>( &a ) ) );
+	CHECK( aAdd != ( IntDelegate::create<Adder, &Adder::add>( &b ) ) );
+	CHECK( aAdd != ( IntDelegate::create<Adder, &Adder::sub>( &a ) ) );
+	CHECK( IntDelegate::create<&twice>() == IntDelegate::create<&twice>() );
+	CHECK( IntDelegate::create<&twice>() != IntDelegate::create<&thrice>() );
+	CHECK( IntDelegate() == IntDelegate() );
+	CHECK( aAdd != IntDelegate() );
+
+	IntDelegate copy = aAdd;
+	CHECK( copy == aAdd );
+	copy.clear();
+	CHECK( copy == IntDelegate() );
+	CHECK( aAdd.getObject() == &a );
+}
+
+EVENT_TEST( EqualDelegatesHashEqually )
+{
+	Adder a = { 1 }, b = { 2 };
+	auto aAdd = IntDelegate::create<Adder, &Adder::add>( &a );
+	CHECK_EQ( aAdd.hash(), ( IntDelegate::create<Adder, &Adder::add>( &a ) ).hash() );
+	CHECK_EQ( std::hash<IntDelegate>()( aAdd ), aAdd.hash() );
+
+	std::unordered_set<IntDelegate> delegates = {
+		aAdd,
+		IntDelegate::create<Adder, &Adder::add>( &a ),
+		IntDelegate::create<Adder, &Adder::sub>( &a ),
+		IntDelegate::create<Adder, &Adder::add>( &b ),
+		IntDelegate::create<Adder, &Adder::sub>( &b ),
+		IntDelegate::create<&twice>(),
+		IntDelegate::create<&thrice>(),
+	};
+	CHECK_EQ( delegates.size(), 6u );
+	CHECK( delegates.count( IntDelegate::create<Adder, &Adder::sub>( &b ) ) );
+
+	// Nearby objects bound to the same function don't collide.
+	Adder adders[64];
+	std::unordered_set<size_t> hashes;
+	for( auto &adder : adders )
+		hashes.insert( IntDelegate::create<Adder, &Adder::add>( &adder ).hash() );
+	CHECK_EQ( hashes.size(), 64u );
+}
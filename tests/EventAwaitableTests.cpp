@@ -0,0 +1,86 @@
+//
+//  EventAwaitableTests.cpp
+//  Cinder-EventManager
+//
+//
+
+#include "EventAwaitable.h"
+#include "EventManager.h"
+#include "TestSupport.h"
+
+#if defined( EVENT_MANAGER_HAS_COROUTINES )
+
+namespace {
+
+class NumberEvent : public EventData {
+public:
+	static constexpr EventType TYPE = 6001;
+
+	explicit NumberEvent( int value ) : mValue( value ) {}
+
+	EventDataRef copy() override { return std::make_shared<NumberEvent>( *this ); }
+	const char* getName() const override { return "NumberEvent"; }
+	EventType getEventType() const override { return TYPE; }
+	void serialize( EventBuffer &/*streamOut*/ ) override {}
+	void deSerialize( const EventBuffer &/*streamIn*/ ) override {}
+
+	int mValue;
+};
+
+//! Counts its own destruction, to tell when a coroutine frame goes away.
+struct FrameGuard {
+	explicit FrameGuard( int &numDestroyed ) : mNumDestroyed( numDestroyed ) {}
+	~FrameGuard() { ++mNumDestroyed; }
+	int &mNumDestroyed;
+};
+
+EventTask sumNumbers( EventManagerBase &manager, int &step, int &total )
+{
+	auto first = co_await manager.next<NumberEvent>();
+	total += first->mValue;
+	step = 1;
+	auto large = co_await manager.next<NumberEvent>( []( const NumberEvent &event ) { return event.mValue > 10; } );
+	total += large->mValue;
+	step = 2;
+}
+
+EventTask waitForever( EventManagerBase &manager, int &numDestroyed )
+{
+	FrameGuard guard( numDestroyed );
+	co_await manager.next<NumberEvent>();
+	co_await manager.next<NumberEvent>();
+}
+
+} // anonymous namespace
+
+EVENT_TEST( CoroutinesResumeOnMatchingEvents )
+{
+	auto manager = EventManager::create( "Test", false );
+	int step = 0, total = 0;
+	sumNumbers( *manager, step, total );
+	CHECK_EQ( step, 0 );
+
+	manager->queueEvent( std::make_shared<NumberEvent>( 1 ) );
+	manager->update();
+	CHECK_EQ( step, 1 );
+	manager->triggerEvent( std::make_shared<NumberEvent>( 5 ) );
+	CHECK_EQ( step, 1 );
+	manager->triggerEvent( std::make_shared<NumberEvent>( 20 ) );
+	CHECK_EQ( step, 2 );
+	CHECK_EQ( total, 21 );
+	CHECK_EQ( manager->getListenerStats().mNumListeners, 0u );
+}
+
+EVENT_TEST( ManagerTeardownDestroysSuspendedCoroutines )
+{
+	int numDestroyed = 0;
+	auto manager = EventManager::create( "Test", false );
+	waitForever( *manager, numDestroyed );
+	waitForever( *manager, numDestroyed );
+	manager->triggerEvent( std::make_shared<NumberEvent>( 1 ) );
+	CHECK_EQ( numDestroyed, 0 );
+	manager.reset();
+	CHECK_EQ( numDestroyed, 2 );
+}
+
+#endif
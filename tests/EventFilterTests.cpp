@@ -0,0 +1,186 @@
+//
+//  EventFilterTests.cpp
+//  Cinder-EventManager
+//
+//
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "EventManager.h"
+#include "TestEvents.h"
+#include "TestSupport.h"
+
+namespace {
+
+const EventType kType = 2001;
+//! A field TestEvent doesn't supply, so clauses on it always fail.
+const uint32_t kMissingField = 3;
+
+//! Straightforward clause by clause evaluation, the reference the vectorized
+//! filter columns must agree with.
+bool passesReference( const EventFilter &filter, const TestEvent &event )
+{
+	for( size_t c = 0; c < filter.getNumClauses(); ++c ) {
+		const auto &clause = filter.getClause( c );
+		const double value = event.getFilterValue( clause.mField );
+		if( ! ( value >= clause.mMin && value <= clause.mMax ) )
+			return false;
+	}
+	return true;
+}
+
+//! Small integral bounds and values, so events often land exactly on a
+//! range's ends.
+EventFilter makeRandomFilter( std::mt19937 &rng )
+{
+	std::uniform_int_distribution<int> coord( 0, 8 ), kind( 0, 11 );
+	auto range = [&]( uint32_t field, EventFilter &filter ) {
+		double a = coord( rng ), b = coord( rng );
+		filter.andRange( field, std::min( a, b ), std::max( a, b ) );
+	};
+	EventFilter filter;
+	switch( kind( rng ) ) {
+		case 0: break;
+		case 1: range( TestEvent::FIELD_X, filter ); break;
+		case 2: range( TestEvent::FIELD_Y, filter ); break;
+		case 3: filter.andEqual( TestEvent::FIELD_X, coord( rng ) ); break;
+		case 4: range( kMissingField, filter ); break;
+		case 5: range( TestEvent::FIELD_Y, filter ); range( kMissingField, filter ); break;
+		case 6: range( TestEvent::FIELD_X, filter ); range( TestEvent::FIELD_Y, filter ); filter.andEqual( TestEvent::FIELD_X, coord( rng ) ); break;
+		case 7:
+			for( size_t c = 0; c < EventFilter::kMaxClauses; ++c )
+				range( c % 2 ? TestEvent::FIELD_Y : TestEvent::FIELD_X, filter );
+			break;
+		default: range( TestEvent::FIELD_X, filter ); range( TestEvent::FIELD_Y, filter ); break;
+	}
+	return filter;
+}
+
+std::vector<TestEvent> makeRandomEvents( std::mt19937 &rng, size_t count )
+{
+	std::uniform_int_distribution<int> coord( -1, 9 ), missing( 0, 9 );
+	std::vector<TestEvent> events;
+	for( size_t i = 0; i < count; ++i ) {
+		double x = missing( rng ) ? coord( rng ) : std::numeric_limits<double>::quiet_NaN();
+		events.emplace_back( kType, x, double( coord( rng ) ) );
+	}
+	return events;
+}
+
+//! Registers \a numListeners randomly filtered listeners and checks that every
+//! event reaches exactly the listeners the reference passes.
+void checkAgainstReference( size_t numListeners, double cellSize, std::mt19937 &rng )
+{
+	auto manager = EventManager::create( "Test", false );
+	if( cellSize > 0.0 )
+		manager->setSpatialIndex( kType, TestEvent::FIELD_X, TestEvent::FIELD_Y, cellSize );
+
+	std::vector<EventFilter> filters;
+	std::vector<size_t> called;
+	for( size_t i = 0; i < numListeners; ++i ) {
+		filters.push_back( makeRandomFilter( rng ) );
+		manager->addListener( [i, &called]( EventDataRef ) { called.push_back( i ); }, kType, filters.back() );
+	}
+
+	for( const auto &event : makeRandomEvents( rng, 40 ) ) {
+		std::vector<size_t> expected;
+		for( size_t i = 0; i < numListeners; ++i ) {
+			if( passesReference( filters[i], event ) )
+				expected.push_back( i );
+		}
+		called.clear();
+		manager->triggerEvent( std::make_shared<TestEvent>( event ) );
+		// The grid visits its cells' listeners out of registration order.
+		std::sort( called.begin(), called.end() );
+		CHECK_EQ( called, expected );
+	}
+}
+
+// Block and vector widths are powers of two, so odd sizes and sizes either
+// side of a 64 listener block exercise the scalar tails.
+const size_t kListenerCounts[] = { 1, 2, 3, 5, 7, 31, 63, 64, 65, 129, 131 };
+
+} // anonymous namespace
+
+EVENT_TEST( FiltersMatchTheReference )
+{
+	std::mt19937 rng( 42 );
+	for( auto count : kListenerCounts )
+		checkAgainstReference( count, 0.0, rng );
+}
+
+EVENT_TEST( GridFiltersMatchTheReference )
+{
+	std::mt19937 rng( 7 );
+	for( auto count : kListenerCounts )
+		checkAgainstReference( count, 2.0, rng );
+}
+
+EVENT_TEST( ChangedFiltersMatchTheReference )
+{
+	std::mt19937 rng( 3 );
+	auto manager = EventManager::create( "Test", false );
+	std::vector<EventFilter> filters;
+	std::vector<EventListenerHandle> handles;
+	std::vector<size_t> called;
+	for( size_t i = 0; i < 67; ++i ) {
+		filters.push_back( makeRandomFilter( rng ) );
+		handles.push_back( manager->addListener( [i, &called]( EventDataRef ) { called.push_back( i ); }, kType, filters.back() ) );
+	}
+	for( size_t i = 0; i < handles.size(); i += 3 ) {
+		filters[i] = makeRandomFilter( rng );
+		CHECK( manager->setListenerFilter( handles[i], filters[i] ) );
+	}
+
+	for( const auto &event : makeRandomEvents( rng, 40 ) ) {
+		std::vector<size_t> expected;
+		for( size_t i = 0; i < filters.size(); ++i ) {
+			if( passesReference( filters[i], event ) )
+				expected.push_back( i );
+		}
+		called.clear();
+		manager->triggerEvent( std::make_shared<TestEvent>( event ) );
+		CHECK_EQ( called, expected );
+	}
+}
+
+EVENT_TEST( FieldsAddedMidDispatchWaitForTheNextOne )
+{
+	auto manager = EventManager::create( "Test", false );
+	int calls = 0;
+	EventListenerHandle filtered;
+	manager->addListener( [&]( EventDataRef ) {
+		manager->setListenerFilter( filtered, EventFilter::range( TestEvent::FIELD_X, 0, 10 ).andRange( TestEvent::FIELD_Y, 0, 10 ) );
+	}, kType );
+	// Filters are evaluated a block at a time, so the change has to land in a
+	// block dispatch hasn't reached yet.
+	for( int i = 0; i < 64; ++i )
+		manager->addListener( []( EventDataRef ) {}, kType, EventFilter::range( TestEvent::FIELD_X, 0, 10 ) );
+	filtered = manager->addListener( [&calls]( EventDataRef ) { ++calls; }, kType, EventFilter::range( TestEvent::FIELD_X, 0, 10 ) );
+
+	// FIELD_Y wasn't loaded for the first event, so its clause fails there.
+	manager->triggerEvent( std::make_shared<TestEvent>( kType, 5.0, 5.0 ) );
+	CHECK_EQ( calls, 0 );
+	manager->triggerEvent( std::make_shared<TestEvent>( kType, 5.0, 5.0 ) );
+	CHECK_EQ( calls, 1 );
+}
+
+EVENT_TEST( FiltersWithTooManyClausesAreRejected )
+{
+	auto manager = EventManager::create( "Test", false );
+	EventFilter filter;
+	for( size_t c = 0; c <= EventFilter::kMaxClauses; ++c )
+		filter.andRange( TestEvent::FIELD_X, 0, 10 );
+	CHECK( ! filter.isValid() );
+
+	int calls = 0;
+	CHECK( ! manager->addListener( [&calls]( EventDataRef ) { ++calls; }, kType, filter ) );
+	auto handle = manager->addListener( [&calls]( EventDataRef ) { ++calls; }, kType, EventFilter::range( TestEvent::FIELD_X, 0, 1 ) );
+	CHECK( ! manager->setListenerFilter( handle, filter ) );
+	manager->triggerEvent( std::make_shared<TestEvent>( kType, 5.0, 5.0 ) );
+	CHECK_EQ( calls, 0 );
+}
@@ -0,0 +1,213 @@
+//
+//  EventListenerTableTests.cpp
+//  Cinder-EventManager
+//
+//
+
+#include <algorithm>
+#include <vector>
+
+#include "EventManager.h"
+
+#include "EventListenerTable.h"
+#include "TestEvents.h"
+#include "TestSupport.h"
+
+namespace {
+
+const EventType kType = 7001;
+const size_t kNumTargets = 256;
+
+struct Target {
+	void onEvent( EventDataRef )
+	{
+		++mCalls;
+		if( mLog )
+			mLog->push_back( this );
+	}
+	int mCalls = 0;
+	std::vector<Target*> *mLog = nullptr;
+};
+
+EventListenerDelegate makeDelegate( Target &target )
+{
+	return EventListenerDelegate::create<Target, &Target::onEvent>( &target );
+}
+
+} // anonymous namespace
+
+EVENT_TEST( DelegateIndexFindsEachListener )
+{
+	EventListenerTable table;
+	std::vector<Target> targets( kNumTargets );
+	std::vector<uint64_t> ids;
+	for( auto &target : targets )
+		ids.push_back( table.add( EventListener( makeDelegate( target ) ) ) );
+
+	for( size_t i = 0; i < kNumTargets; ++i ) {
+		CHECK( ids[i] != 0 );
+		CHECK_EQ( table.getId( makeDelegate( targets[i] ) ), ids[i] );
+		CHECK( table.get( ids[i] )->getDelegate() == makeDelegate( targets[i] ) );
+	}
+	Target stranger;
+	CHECK( ! table.contains( makeDelegate( stranger ) ) );
+	CHECK( ! table.remove( makeDelegate( stranger ) ) );
+}
+
+EVENT_TEST( DelegateIndexFollowsRemovals )
+{
+	EventListenerTable table;
+	std::vector<Target> targets( kNumTargets );
+	std::vector<uint64_t> ids;
+	for( auto &target : targets )
+		ids.push_back( table.add( EventListener( makeDelegate( target ) ) ) );
+
+	// Remove every other listener, alternately by delegate and by id.
+	for( size_t i = 0; i < kNumTargets; i += 2 )
+		CHECK( i % 4 ? table.remove( makeDelegate( targets[i] ) ) : table.remove( ids[i] ) );
+	CHECK_EQ( table.size(), kNumTargets / 2 );
+	for( size_t i = 0; i < kNumTargets; ++i ) {
+		CHECK_EQ( table.contains( makeDelegate( targets[i] ) ), i % 2 == 1 );
+		CHECK_EQ( table.getId( makeDelegate( targets[i] ) ), i % 2 ? ids[i] : 0u );
+	}
+
+	// Re-added delegates get fresh ids; the stale ones stay dead.
+	for( size_t i = 0; i < kNumTargets; i += 2 ) {
+		auto id = table.add( EventListener( makeDelegate( targets[i] ) ) );
+		CHECK( id != ids[i] );
+		CHECK_EQ( table.getId( makeDelegate( targets[i] ) ), id );
+		CHECK( ! table.get( ids[i] ) );
+	}
+
+	TestEvent event( kType );
+	auto eventRef = std::make_shared<TestEvent>( kType );
+	table.dispatch( event, [&]( EventListener &listener ) { listener.invoke( eventRef ); } );
+	for( auto &target : targets )
+		CHECK_EQ( target.mCalls, 1 );
+}
+
+EVENT_TEST( DelegateIndexIsUpdatedDuringDispatch )
+{
+	EventListenerTable table;
+	Target first, second, late;
+	table.add( EventListener( makeDelegate( first ) ) );
+	table.add( EventListener( makeDelegate( second ) ) );
+
+	TestEvent event( kType );
+	table.dispatch( event, [&]( EventListener & ) {
+		if( table.contains( makeDelegate( second ) ) ) {
+			CHECK( table.remove( makeDelegate( second ) ) );
+			CHECK( ! table.contains( makeDelegate( second ) ) );
+			CHECK( table.add( EventListener( makeDelegate( late ) ) ) );
+			CHECK( table.contains( makeDelegate( late ) ) );
+		}
+	} );
+	CHECK( table.contains( makeDelegate( first ) ) );
+	CHECK( ! table.contains( makeDelegate( second ) ) );
+	CHECK( table.remove( makeDelegate( late ) ) );
+	CHECK_EQ( table.size(), 1u );
+}
+
+EVENT_TEST( DelegateIndexFollowsRebinds )
+{
+	EventListenerTable table;
+	Target before, after;
+	auto id = table.add( EventListener( makeDelegate( before ) ) );
+	CHECK( table.rebind( id, &after ) );
+	CHECK( ! table.contains( makeDelegate( before ) ) );
+	CHECK_EQ( table.getId( makeDelegate( after ) ), id );
+
+	auto other = table.add( EventListener( makeDelegate( before ) ) );
+	CHECK( other != 0 );
+	CHECK( ! table.rebind( other, &after ) );
+	CHECK_EQ( table.getId( makeDelegate( before ) ), other );
+}
+
+EVENT_TEST( DefragmentKeepsIdsValid )
+{
+	EventListenerTable table;
+	std::vector<Target> targets( kNumTargets );
+	std::vector<Target*> log;
+	std::vector<uint64_t> ids( kNumTargets );
+	// Registered back to front so sorting by target has to reorder them, each
+	// with a filter that only passes its own x, so filters must move with them.
+	for( size_t i = kNumTargets; i-- > 0; ) {
+		targets[i].mLog = &log;
+		ids[i] = table.add( EventListener( makeDelegate( targets[i] ) ), EventFilter::range( TestEvent::FIELD_X, double( i ), double( i ) ) );
+	}
+	// Few enough removals that remove() leaves the holes to defragment().
+	for( size_t i = 0; i < kNumTargets; i += 4 )
+		CHECK( table.remove( ids[i] ) );
+	CHECK( table.needsDefragment( false ) );
+
+	auto checkIds = [&] {
+		for( size_t i = 0; i < kNumTargets; ++i ) {
+			auto listener = table.get( ids[i] );
+			if( i % 4 == 0 ) {
+				CHECK( ! listener );
+				continue;
+			}
+			CHECK( listener && listener->getDelegate() == makeDelegate( targets[i] ) );
+			CHECK_EQ( table.getId( makeDelegate( targets[i] ) ), ids[i] );
+		}
+	};
+	auto dispatchAt = [&]( double x ) {
+		auto event = std::make_shared<TestEvent>( kType, x, 0.0 );
+		table.dispatch( *event, [&]( EventListener &listener ) { listener.invoke( event ); } );
+	};
+
+	table.defragment( false );
+	EventListenerStats stats;
+	table.addStats( stats );
+	CHECK_EQ( stats.mNumHoles, 0u );
+	CHECK_EQ( stats.mNumUnsortedTables, 1u );
+	checkIds();
+
+	table.defragment( true );
+	CHECK( ! table.needsDefragment( true ) );
+	checkIds();
+	for( size_t i = 0; i < kNumTargets; ++i )
+		dispatchAt( double( i ) );
+	std::vector<Target*> expected;
+	for( size_t i = 0; i < kNumTargets; ++i ) {
+		if( i % 4 )
+			expected.push_back( &targets[i] );
+	}
+	CHECK( log == expected );
+
+	// Ids still remove and rebind the right slots.
+	Target replacement;
+	replacement.mLog = &log;
+	CHECK( table.rebind( ids[1], &replacement ) );
+	CHECK( table.remove( ids[2] ) );
+	log.clear();
+	dispatchAt( 1.0 );
+	dispatchAt( 2.0 );
+	CHECK( log == std::vector<Target*>{ &replacement } );
+}
+
+EVENT_TEST( ManagerDefragmentKeepsHandlesValid )
+{
+	auto manager = EventManager::create( "Test", false );
+	manager->setDefragmentBudget( 1000000 );
+	manager->setSortListenersByTarget( true );
+	std::vector<Target> targets( kNumTargets );
+	std::vector<EventListenerHandle> handles;
+	for( size_t i = kNumTargets; i-- > 0; )
+		handles.push_back( manager->addListener( EventListener( makeDelegate( targets[i] ) ), kType ) );
+	for( size_t i = 0; i < handles.size(); i += 2 )
+		CHECK( manager->removeListener( handles[i] ) );
+
+	manager->update();
+	auto stats = manager->getListenerStats();
+	CHECK_EQ( stats.mNumHoles, 0u );
+	CHECK_EQ( stats.mNumUnsortedTables, 0u );
+	CHECK_EQ( stats.mNumListeners, kNumTargets / 2 );
+
+	manager->triggerEvent( makeEvent( kType ) );
+	size_t numCalled = std::count_if( targets.begin(), targets.end(), []( const Target &target ) { return target.mCalls == 1; } );
+	CHECK_EQ( numCalled, kNumTargets / 2 );
+	for( size_t i = 0; i < handles.size(); ++i )
+		CHECK_EQ( manager->removeListener( handles[i] ), i % 2 == 1 );
+	CHECK_EQ( manager->getListenerStats().mNumListeners, 0u );
+}
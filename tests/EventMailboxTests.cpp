@@ -0,0 +1,101 @@
+//
+//  EventMailboxTests.cpp
+//  Cinder-EventManager
+//
+//
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "EventMailbox.h"
+#include "EventManager.h"
+#include "TestEvents.h"
+#include "TestSupport.h"
+
+namespace {
+
+const EventType kType = 3001;
+const int kNumWorkers = 4;
+const int kNumEventsPerWorker = 20000;
+
+} // anonymous namespace
+
+EVENT_TEST( MailboxKeepsEachProducersOrder )
+{
+	EventMailbox mailbox;
+	std::vector<std::thread> producers;
+	std::atomic<int> numDone( 0 );
+	for( int p = 0; p < kNumWorkers; ++p ) {
+		producers.emplace_back( [&, p] {
+			for( int i = 0; i < kNumEventsPerWorker; ++i )
+				mailbox.push( makeEvent( kType, p * kNumEventsPerWorker + i ) );
+			++numDone;
+		} );
+	}
+
+	std::vector<int> lastSeen( kNumWorkers, -1 );
+	int numOutOfOrder = 0, numDrained = 0;
+	auto take = [&]( EventDataRef &&event ) {
+		int value = std::static_pointer_cast<TestEvent>( event )->getValue();
+		int &last = lastSeen[value / kNumEventsPerWorker];
+		numOutOfOrder += last >= value % kNumEventsPerWorker;
+		last = value % kNumEventsPerWorker;
+		++numDrained;
+	};
+	while( numDone < kNumWorkers )
+		mailbox.drain( take );
+	mailbox.drain( take );
+	for( auto &producer : producers )
+		producer.join();
+
+	CHECK_EQ( numDrained, kNumWorkers * kNumEventsPerWorker );
+	CHECK_EQ( numOutOfOrder, 0 );
+	CHECK( mailbox.empty() );
+}
+
+// Each worker owns a manager and queues to the next worker's, so every
+// manager's mailbox has a producer on another thread while it drains.
+EVENT_TEST( WorkerRingDeliversEveryEventInOrder )
+{
+	std::vector<EventManagerRef> managers( kNumWorkers );
+	std::vector<int> counts( kNumWorkers, 0 ), numOutOfOrder( kNumWorkers, 0 );
+	std::atomic<int> numReady( 0 );
+	std::vector<std::thread> workers;
+	for( int w = 0; w < kNumWorkers; ++w ) {
+		workers.emplace_back( [&, w] {
+			managers[w] = EventManager::create( "Worker " + std::to_string( w ), false );
+			int last = -1;
+			managers[w]->addListener( [&, w]( EventDataRef event ) {
+				int value = std::static_pointer_cast<TestEvent>( event )->getValue();
+				numOutOfOrder[w] += last >= value;
+				last = value;
+				++counts[w];
+			}, kType );
+			++numReady;
+			while( numReady < kNumWorkers )
+				std::this_thread::yield();
+
+			auto &next = managers[( w + 1 ) % kNumWorkers];
+			for( int i = 0; i < kNumEventsPerWorker; ++i ) {
+				next->queueEvent( makeEvent( kType, i ) );
+				if( i % 64 == 0 )
+					managers[w]->update();
+			}
+			while( counts[w] < kNumEventsPerWorker )
+				managers[w]->update();
+			// Nobody may destroy a manager its neighbour still queues to.
+			++numReady;
+			while( numReady < 2 * kNumWorkers )
+				std::this_thread::yield();
+		} );
+	}
+	for( auto &worker : workers )
+		worker.join();
+
+	for( int w = 0; w < kNumWorkers; ++w ) {
+		CHECK_EQ( counts[w], kNumEventsPerWorker );
+		CHECK_EQ( numOutOfOrder[w], 0 );
+	}
+}
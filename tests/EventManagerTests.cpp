@@ -0,0 +1,478 @@
+//
+//  EventManagerTests.cpp
+//  Cinder-EventManager
+//
+//
+
+#include <thread>
+#include <vector>
+
+#include "EventManager.h"
+#include "TestEvents.h"
+#include "TestSupport.h"
+
+namespace {
+
+const EventType kTypeA = 1001;
+const EventType kTypeB = 1002;
+const EventType kTypeC = 1003;
+
+struct Recorder {
+	void onEvent( EventDataRef event ) { mValues.push_back( std::static_pointer_cast<TestEvent>( event )->getValue() ); }
+	std::vector<int> mValues;
+};
+
+struct Counter {
+	explicit Counter( int *calls ) : mCalls( calls ) {}
+	void onEvent( EventDataRef ) { ++*mCalls; }
+	int *mCalls;
+};
+
+EventListenerDelegate makeDelegate( Recorder &recorder )
+{
+	return EventListenerDelegate::create<Recorder, &Recorder::onEvent>( &recorder );
+}
+
+} // anonymous namespace
+
+EVENT_TEST( TriggerCallsListenersOfTheType )
+{
+	auto manager = EventManager::create( "Test", false );
+	Recorder a, b;
+	CHECK( manager->addListener( makeDelegate( a ), kTypeA ) );
+	CHECK( manager->addListener( makeDelegate( b ), kTypeB ) );
+
+	CHECK( manager->triggerEvent( makeEvent( kTypeA, 1 ) ) );
+	CHECK_EQ( a.mValues, std::vector<int>{ 1 } );
+	CHECK( b.mValues.empty() );
+}
+
+EVENT_TEST( RejectsDoubleRegistration )
+{
+	auto manager = EventManager::create( "Test", false );
+	Recorder recorder;
+	CHECK( manager->addListener( makeDelegate( recorder ), kTypeA ) );
+	CHECK( ! manager->addListener( makeDelegate( recorder ), kTypeA ) );
+	manager->triggerEvent( makeEvent( kTypeA, 1 ) );
+	CHECK_EQ( recorder.mValues.size(), 1u );
+}
+
+EVENT_TEST( QueuedEventsWaitForUpdateInOrder )
+{
+	auto manager = EventManager::create( "Test", false );
+	Recorder recorder;
+	manager->addListener( makeDelegate( recorder ), kTypeA );
+
+	for( int i = 0; i < 3; ++i )
+		CHECK( manager->queueEvent( makeEvent( kTypeA, i ) ) );
+	CHECK( recorder.mValues.empty() );
+	CHECK( manager->update() );
+	CHECK_EQ( recorder.mValues, ( std::vector<int>{ 0, 1, 2 } ) );
+}
+
+EVENT_TEST( EventsQueuedDuringUpdateWaitForTheNextOne )
+{
+	auto manager = EventManager::create( "Test", false );
+	Recorder recorder;
+	manager->addListener( makeDelegate( recorder ), kTypeA );
+	auto owner = manager.get();
+	manager->addListener( [owner]( EventDataRef ) { owner->queueEvent( makeEvent( kTypeA, 2 ) ); }, kTypeB );
+
+	manager->queueEvent( makeEvent( kTypeB ) );
+	manager->update();
+	CHECK( recorder.mValues.empty() );
+	manager->update();
+	CHECK_EQ( recorder.mValues, std::vector<int>{ 2 } );
+}
+
+EVENT_TEST( QueueEventWithoutListenersIsSkipped )
+{
+	auto manager = EventManager::create( "Test", false );
+	CHECK( ! manager->queueEvent( makeEvent( kTypeA ) ) );
+	CHECK( ! manager->triggerEvent( makeEvent( kTypeA ) ) );
+}
+
+EVENT_TEST( RemovedListenersStopHearingEvents )
+{
+	auto manager = EventManager::create( "Test", false );
+	Recorder recorder;
+	manager->addListener( makeDelegate( recorder ), kTypeA );
+	CHECK( manager->removeListener( makeDelegate( recorder ), kTypeA ) );
+	CHECK( ! manager->removeListener( makeDelegate( recorder ), kTypeA ) );
+	manager->triggerEvent( makeEvent( kTypeA ) );
+	CHECK( recorder.mValues.empty() );
+}
+
+EVENT_TEST( CallableListenersAreRemovedByHandle )
+{
+	auto manager = EventManager::create( "Test", false );
+	int calls = 0;
+	auto handle = manager->addListener( [&calls]( EventDataRef ) { ++calls; }, kTypeA );
+	CHECK( handle );
+	manager->triggerEvent( makeEvent( kTypeA ) );
+	CHECK( manager->removeListener( handle ) );
+	manager->triggerEvent( makeEvent( kTypeA ) );
+	CHECK_EQ( calls, 1 );
+}
+
+EVENT_TEST( TimeLimitedUpdateKeepsLeftovers )
+{
+	auto manager = EventManager::create( "Test", false );
+	static double sNow = 0.0;
+	manager->setClock( [] { return sNow; } );
+	Recorder recorder;
+	manager->addListener( makeDelegate( recorder ), kTypeA );
+	manager->addListener( []( EventDataRef ) { sNow += 1.0; }, kTypeA );
+
+	for( int i = 0; i < 3; ++i )
+		manager->queueEvent( makeEvent( kTypeA, i ) );
+	CHECK( ! manager->update( 500 ) );
+	CHECK_EQ( recorder.mValues, std::vector<int>{ 0 } );
+	CHECK( manager->update() );
+	CHECK_EQ( recorder.mValues, ( std::vector<int>{ 0, 1, 2 } ) );
+}
+
+EVENT_TEST( OnceListenersHearOneEvent )
+{
+	auto manager = EventManager::create( "Test", false );
+	Recorder recorder;
+	auto handle = manager->addListenerOnce( makeDelegate( recorder ), kTypeA );
+	CHECK( handle );
+	manager->triggerEvent( makeEvent( kTypeA, 1 ) );
+	manager->triggerEvent( makeEvent( kTypeA, 2 ) );
+	CHECK_EQ( recorder.mValues, std::vector<int>{ 1 } );
+	CHECK( ! manager->removeListener( handle ) );
+}
+
+EVENT_TEST( OnceListenersAreNotReentered )
+{
+	auto manager = EventManager::create( "Test", false );
+	int calls = 0;
+	manager->addListenerOnce( [&]( EventDataRef ) {
+		++calls;
+		manager->triggerEvent( makeEvent( kTypeA ) );
+	}, kTypeA );
+	manager->triggerEvent( makeEvent( kTypeA ) );
+	CHECK_EQ( calls, 1 );
+}
+
+EVENT_TEST( RemoveAllListenersForCoversTypesAndKeys )
+{
+	auto manager = EventManager::create( "Test", false );
+	Recorder owner, other;
+	manager->addListener( makeDelegate( owner ), kTypeA );
+	manager->addListener( makeDelegate( owner ), kTypeB );
+	manager->addListener( makeDelegate( owner ), kTypeA, EventKey( 7 ) );
+	manager->addListener( makeDelegate( other ), kTypeA );
+
+	CHECK_EQ( manager->removeAllListenersFor( &owner ), 3u );
+	CHECK_EQ( manager->removeAllListenersFor( &owner ), 0u );
+	manager->triggerEvent( makeEvent( kTypeA, 1 ) );
+	manager->triggerEvent( makeEvent( kTypeB, 2 ) );
+	manager->triggerEvent( makeEvent( kTypeA, 3, 7 ) );
+	CHECK( owner.mValues.empty() );
+	CHECK_EQ( other.mValues, ( std::vector<int>{ 1, 3 } ) );
+}
+
+EVENT_TEST( RemoveAllListenersForDuringDispatch )
+{
+	auto manager = EventManager::create( "Test", false );
+	Recorder owner;
+	manager->addListener( [&]( EventDataRef ) { manager->removeAllListenersFor( &owner ); }, kTypeA );
+	manager->addListener( makeDelegate( owner ), kTypeA );
+	manager->addListener( makeDelegate( owner ), kTypeB );
+
+	manager->triggerEvent( makeEvent( kTypeA, 1 ) );
+	CHECK( owner.mValues.empty() );
+	manager->triggerEvent( makeEvent( kTypeB, 2 ) );
+	manager->triggerEvent( makeEvent( kTypeA, 3 ) );
+	CHECK( owner.mValues.empty() );
+	CHECK( manager->addListener( makeDelegate( owner ), kTypeB ) );
+	manager->triggerEvent( makeEvent( kTypeB, 4 ) );
+	CHECK_EQ( owner.mValues, std::vector<int>{ 4 } );
+}
+
+EVENT_TEST( ScopedListenersAreRemovedOnDestruction )
+{
+	auto manager = EventManager::create( "Test", false );
+	Recorder recorder;
+	{
+		auto token = manager->addScopedListener( makeDelegate( recorder ), kTypeA );
+		CHECK( token );
+		CHECK( ! manager->addScopedListener( makeDelegate( recorder ), kTypeA ) );
+		manager->triggerEvent( makeEvent( kTypeA, 1 ) );
+	}
+	manager->triggerEvent( makeEvent( kTypeA, 2 ) );
+	CHECK_EQ( recorder.mValues, std::vector<int>{ 1 } );
+	CHECK( manager->addListener( makeDelegate( recorder ), kTypeA ) );
+}
+
+EVENT_TEST( MovedScopedListenersKeepTheRegistration )
+{
+	auto manager = EventManager::create( "Test", false );
+	Recorder recorder;
+	ScopedListener outer;
+	{
+		auto token = manager->addScopedListener( makeDelegate( recorder ), kTypeA );
+		outer = std::move( token );
+		CHECK( ! token );
+	}
+	manager->triggerEvent( makeEvent( kTypeA, 1 ) );
+	ScopedListener moved( std::move( outer ) );
+	CHECK( ! outer );
+	manager->triggerEvent( makeEvent( kTypeA, 2 ) );
+	moved.reset();
+	manager->triggerEvent( makeEvent( kTypeA, 3 ) );
+	CHECK_EQ( recorder.mValues, ( std::vector<int>{ 1, 2 } ) );
+}
+
+EVENT_TEST( RebindMovesTheDelegateAndOwner )
+{
+	auto manager = EventManager::create( "Test", false );
+	Recorder before, after;
+	auto token = manager->addScopedListener( makeDelegate( before ), kTypeA );
+	CHECK( token.rebind( &after ) );
+	manager->triggerEvent( makeEvent( kTypeA, 1 ) );
+	CHECK( before.mValues.empty() );
+	CHECK_EQ( after.mValues, std::vector<int>{ 1 } );
+
+	// The delegate index follows the slot, so the old pairing is free again.
+	CHECK( ! manager->removeListener( makeDelegate( before ), kTypeA ) );
+	CHECK( ! manager->addListener( makeDelegate( after ), kTypeA ) );
+	CHECK( manager->addListener( makeDelegate( before ), kTypeA ) );
+
+	// So does the owner index.
+	CHECK_EQ( manager->removeAllListenersFor( &after ), 1u );
+	CHECK( ! token.rebind( &before ) );
+	manager->triggerEvent( makeEvent( kTypeA, 2 ) );
+	CHECK_EQ( before.mValues, std::vector<int>{ 2 } );
+	CHECK_EQ( after.mValues, std::vector<int>{ 1 } );
+}
+
+EVENT_TEST( WeakListenersGoQuietOnceTheOwnerExpires )
+{
+	auto manager = EventManager::create( "Test", false );
+	int calls = 0;
+	auto counter = std::make_shared<Counter>( &calls );
+	std::weak_ptr<Counter> observer = counter;
+	CHECK( ( manager->addWeakListener<Counter, &Counter::onEvent>( counter, kTypeA ) ) );
+	manager->triggerEvent( makeEvent( kTypeA ) );
+	CHECK_EQ( calls, 1 );
+	CHECK_EQ( observer.use_count(), 1 );
+
+	counter.reset();
+	manager->triggerEvent( makeEvent( kTypeA ) );
+	CHECK_EQ( calls, 1 );
+}
+
+EVENT_TEST( ExpiredWeakListenersAreRemovedByUpdate )
+{
+	auto manager = EventManager::create( "Test", false );
+	auto recorder = std::make_shared<Recorder>();
+	auto handle = manager->addWeakListener<Recorder, &Recorder::onEvent>( recorder, kTypeA );
+	int calls = 0;
+	manager->addListener( [&calls]( EventDataRef ) { ++calls; }, kTypeA );
+
+	recorder.reset();
+	manager->queueEvent( makeEvent( kTypeA ) );
+	CHECK( manager->update() );
+	CHECK_EQ( calls, 1 );
+	CHECK( ! manager->removeListener( handle ) );
+}
+
+EVENT_TEST( KeyedListenersHearTheirKeyAlongsideWholeType )
+{
+	auto manager = EventManager::create( "Test", false );
+	Recorder keyed, other, whole;
+	manager->addListener( makeDelegate( keyed ), kTypeA, EventKey( 7 ) );
+	manager->addListener( makeDelegate( other ), kTypeA, EventKey( 8 ) );
+	manager->addListener( makeDelegate( whole ), kTypeA );
+
+	manager->triggerEvent( makeEvent( kTypeA, 1, 7 ) );
+	manager->triggerEvent( makeEvent( kTypeA, 2, 9 ) );
+	manager->triggerEvent( makeEvent( kTypeA, 3 ) );
+	CHECK_EQ( keyed.mValues, std::vector<int>{ 1 } );
+	CHECK( other.mValues.empty() );
+	CHECK_EQ( whole.mValues, ( std::vector<int>{ 1, 2, 3 } ) );
+}
+
+EVENT_TEST( EmptyKeyedTablesAreReleased )
+{
+	auto manager = EventManager::create( "Test", false );
+	Recorder recorder;
+	manager->addListener( makeDelegate( recorder ), kTypeA, EventKey( 7 ) );
+	CHECK( manager->queueEvent( makeEvent( kTypeA, 1, 7 ) ) );
+	CHECK( ! manager->queueEvent( makeEvent( kTypeA, 2, 8 ) ) );
+
+	CHECK( manager->removeListener( makeDelegate( recorder ), kTypeA, EventKey( 7 ) ) );
+	CHECK( ! manager->queueEvent( makeEvent( kTypeA, 3, 7 ) ) );
+	manager->update();
+	CHECK( recorder.mValues.empty() );
+}
+
+EVENT_TEST( KeyedTablesEmptiedDuringDispatchAreReleasedAfter )
+{
+	auto manager = EventManager::create( "Test", false );
+	int calls = 0;
+	EventListenerHandle handle;
+	handle = manager->addListener( [&]( EventDataRef ) {
+		++calls;
+		CHECK( manager->removeListener( handle ) );
+	}, kTypeA, EventKey( 7 ) );
+
+	manager->triggerEvent( makeEvent( kTypeA, 1, 7 ) );
+	CHECK_EQ( calls, 1 );
+	CHECK( ! manager->queueEvent( makeEvent( kTypeA, 2, 7 ) ) );
+	CHECK( manager->addListener( [&calls]( EventDataRef ) { ++calls; }, kTypeA, EventKey( 7 ) ) );
+	manager->triggerEvent( makeEvent( kTypeA, 3, 7 ) );
+	CHECK_EQ( calls, 2 );
+}
+
+EVENT_TEST( ParentListenersHearChildEvents )
+{
+	auto manager = EventManager::create( "Test", false );
+	CHECK( manager->setEventTypeParent( kTypeB, kTypeA ) );
+	CHECK( ! manager->setEventTypeParent( kTypeA, kTypeB ) );
+	Recorder parent, child;
+	manager->addListener( makeDelegate( parent ), kTypeA );
+	manager->addListener( makeDelegate( child ), kTypeB );
+
+	manager->triggerEvent( makeEvent( kTypeB, 1 ) );
+	manager->triggerEvent( makeEvent( kTypeA, 2 ) );
+	CHECK_EQ( parent.mValues, ( std::vector<int>{ 1, 2 } ) );
+	CHECK_EQ( child.mValues, std::vector<int>{ 1 } );
+
+	CHECK( manager->setEventTypeParent( kTypeB, ANY_EVENT_TYPE ) );
+	manager->triggerEvent( makeEvent( kTypeB, 3 ) );
+	CHECK_EQ( parent.mValues, ( std::vector<int>{ 1, 2 } ) );
+}
+
+EVENT_TEST( DispatchRunsFromTheTypeUpToAnyEventType )
+{
+	auto manager = EventManager::create( "Test", false );
+	manager->setEventTypeParent( kTypeC, kTypeB );
+	manager->setEventTypeParent( kTypeB, kTypeA );
+	std::vector<EventType> order;
+	for( auto type : { ANY_EVENT_TYPE, kTypeA, kTypeB, kTypeC } )
+		manager->addListener( [&order, type]( EventDataRef ) { order.push_back( type ); }, type );
+
+	manager->triggerEvent( makeEvent( kTypeC ) );
+	CHECK_EQ( order, ( std::vector<EventType>{ kTypeC, kTypeB, kTypeA, ANY_EVENT_TYPE } ) );
+}
+
+EVENT_TEST( AnyEventTypeListenersHearEveryEvent )
+{
+	auto manager = EventManager::create( "Test", false );
+	Recorder any;
+	manager->addListener( makeDelegate( any ), ANY_EVENT_TYPE );
+	CHECK( manager->queueEvent( makeEvent( kTypeA, 1 ) ) );
+	CHECK( manager->queueEvent( makeEvent( kTypeB, 2, 7 ) ) );
+	manager->update();
+	manager->triggerEvent( makeEvent( kTypeC, 3 ) );
+	CHECK_EQ( any.mValues, ( std::vector<int>{ 1, 2, 3 } ) );
+}
+
+EVENT_TEST( TypesRegisteredAfterADispatchJoinItsChain )
+{
+	auto manager = EventManager::create( "Test", false );
+	manager->setEventTypeParent( kTypeB, kTypeA );
+	Recorder child, parent, any;
+	manager->addListener( makeDelegate( child ), kTypeB );
+	manager->triggerEvent( makeEvent( kTypeB, 1 ) );
+
+	// Both new tables must invalidate kTypeB's cached chain.
+	manager->addListener( makeDelegate( parent ), kTypeA );
+	manager->triggerEvent( makeEvent( kTypeB, 2 ) );
+	manager->addListener( makeDelegate( any ), ANY_EVENT_TYPE );
+	manager->triggerEvent( makeEvent( kTypeB, 3 ) );
+	// So must a new parent.
+	manager->triggerEvent( makeEvent( kTypeC, 0 ) );
+	manager->setEventTypeParent( kTypeC, kTypeB );
+	manager->triggerEvent( makeEvent( kTypeC, 4 ) );
+
+	CHECK_EQ( child.mValues, ( std::vector<int>{ 1, 2, 3, 4 } ) );
+	CHECK_EQ( parent.mValues, ( std::vector<int>{ 2, 3, 4 } ) );
+	CHECK_EQ( any.mValues, ( std::vector<int>{ 3, 0, 4 } ) );
+}
+
+EVENT_TEST( ListenerSlotsKeepDelegatesOfAnyValueCategory )
+{
+	auto manager = EventManager::create( "Test", false );
+	Recorder recorder;
+	auto delegate = makeDelegate( recorder );
+	auto handle = manager->addListener( EventListener( delegate ), kTypeA );
+	CHECK( handle );
+	CHECK( ! manager->addListener( EventListener( makeDelegate( recorder ) ), kTypeA ) );
+	CHECK_EQ( manager->removeAllListenersFor( &recorder ), 1u );
+	CHECK( manager->addListener( EventListener( makeDelegate( recorder ) ), kTypeB ) );
+	CHECK( manager->removeListener( delegate, kTypeB ) );
+}
+
+EVENT_TEST( CurrentManagerScopesNest )
+{
+	auto global = EventManager::create( "Global", true );
+	auto outer = EventManager::create( "Outer", false );
+	auto inner = EventManager::create( "Inner", false );
+	CHECK( EventManagerBase::get() == global.get() );
+	{
+		CurrentEventManagerScope outerScope( outer.get() );
+		CHECK( EventManagerBase::get() == outer.get() );
+		{
+			CurrentEventManagerScope innerScope( inner.get() );
+			CHECK( EventManagerBase::get() == inner.get() );
+			CHECK( EventManagerBase::getGlobal() == global.get() );
+
+			// The current manager is per thread.
+			EventManagerBase *seen = nullptr;
+			std::thread other( [&seen] { seen = EventManagerBase::get(); } );
+			other.join();
+			CHECK( seen == global.get() );
+		}
+		CHECK( EventManagerBase::get() == outer.get() );
+		{
+			CurrentEventManagerScope fallback( nullptr );
+			CHECK( EventManagerBase::get() == global.get() );
+		}
+		CHECK( EventManagerBase::get() == outer.get() );
+	}
+	CHECK( EventManagerBase::get() == global.get() );
+	global.reset();
+	CHECK( ! EventManagerBase::get() );
+}
+
+EVENT_TEST( ForwardingStopsQuietlyOnceTheTargetDies )
+{
+	auto source = EventManager::create( "Source", false );
+	std::shared_ptr<EventManager> target = EventManager::create( "Target", false );
+	Recorder recorder;
+	target->addListener( makeDelegate( recorder ), kTypeA );
+	auto handle = source->forwardEvents( kTypeA, target );
+	CHECK( handle );
+
+	CHECK( source->triggerEvent( makeEvent( kTypeA, 1 ) ) );
+	CHECK( recorder.mValues.empty() );
+	target->update();
+	CHECK_EQ( recorder.mValues, std::vector<int>{ 1 } );
+
+	target.reset();
+	source->triggerEvent( makeEvent( kTypeA, 2 ) );
+	source->queueEvent( makeEvent( kTypeA, 3 ) );
+	source->update();
+	CHECK_EQ( recorder.mValues, std::vector<int>{ 1 } );
+	CHECK( source->removeListener( handle ) );
+}
+
+// Debug builds assert instead.
+#if defined( NDEBUG )
+EVENT_TEST( ManagersDontForwardToThemselves )
+{
+	auto manager = EventManager::create( "Test", false );
+	int calls = 0;
+	manager->addListener( [&calls]( EventDataRef ) { ++calls; }, kTypeA );
+	CHECK( ! manager->forwardEvents( kTypeA, manager ) );
+	manager->queueEvent( makeEvent( kTypeA ) );
+	manager->update();
+	manager->update();
+	CHECK_EQ( calls, 1 );
+}
+#endif
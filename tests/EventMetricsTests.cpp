@@ -0,0 +1,115 @@
+//
+//  EventMetricsTests.cpp
+//  Cinder-EventManager
+//
+//
+
+#include <thread>
+#include <vector>
+
+#include "EventManager.h"
+#include "TestEvents.h"
+#include "TestSupport.h"
+
+namespace {
+
+const EventType kTypeA = 5001;
+const EventType kTypeB = 5002;
+
+const EventTypeMetrics* findType( const EventMetricsSnapshot &snapshot, EventType type )
+{
+	for( const auto &metrics : snapshot.mEventTypes ) {
+		if( metrics.mType == type )
+			return &metrics;
+	}
+	return nullptr;
+}
+
+} // anonymous namespace
+
+EVENT_TEST( ManagersCountEventsPerType )
+{
+	auto manager = EventManager::create( "Test", false );
+	int calls = 0;
+	manager->addListener( [&calls]( EventDataRef ) { ++calls; }, kTypeA );
+	manager->addListener( [&calls]( EventDataRef ) { ++calls; }, kTypeB );
+
+	manager->triggerEvent( makeEvent( kTypeA ) );
+	manager->triggerEvent( makeEvent( kTypeA ) );
+	for( int i = 0; i < 3; ++i )
+		manager->queueEvent( makeEvent( kTypeA ) );
+	manager->queueEvent( makeEvent( kTypeB ) );
+	manager->update();
+
+	auto snapshot = manager->snapshotMetrics();
+	auto a = findType( snapshot, kTypeA );
+	auto b = findType( snapshot, kTypeB );
+	CHECK( a && b );
+	CHECK_EQ( a->mNumTriggered, 2u );
+	CHECK_EQ( a->mNumQueued, 3u );
+	CHECK_EQ( a->mNumDispatched, 3u );
+	CHECK_EQ( b->mNumTriggered, 0u );
+	CHECK_EQ( b->mNumQueued, 1u );
+	CHECK_EQ( b->mNumDispatched, 1u );
+
+	uint64_t numListenerCalls = 0;
+	for( const auto &listener : snapshot.mListeners )
+		numListenerCalls += listener.mLatency.mCount;
+	CHECK_EQ( numListenerCalls, 6u );
+	CHECK_EQ( snapshot.mListeners.size(), 2u );
+	CHECK_EQ( snapshot.mNumDropped, 0u );
+}
+
+EVENT_TEST( SnapshotsMergeEveryThread )
+{
+	EventMetrics metrics;
+	const int kNumThreads = 4, kNumPerThread = 1000;
+	std::vector<std::thread> threads;
+	for( int t = 0; t < kNumThreads; ++t ) {
+		threads.emplace_back( [&metrics] {
+			for( int i = 0; i < kNumPerThread; ++i ) {
+				metrics.recordQueued( kTypeA );
+				metrics.recordListener( kTypeA, 1, 100 );
+			}
+		} );
+	}
+	for( auto &thread : threads )
+		thread.join();
+
+	auto snapshot = metrics.snapshot();
+	CHECK_EQ( findType( snapshot, kTypeA )->mNumQueued, uint64_t( kNumThreads * kNumPerThread ) );
+	CHECK_EQ( snapshot.mListeners.size(), 1u );
+	CHECK_EQ( snapshot.mListeners[0].mLatency.mCount, uint64_t( kNumThreads * kNumPerThread ) );
+}
+
+EVENT_TEST( BucketsAreWithinAQuarterOfTheValue )
+{
+	for( uint64_t nanos = 1; nanos < ( uint64_t( 1 ) << 32 ); nanos = nanos * 3 / 2 + 1 ) {
+		auto bound = EventLatencyHistogram::getBucketLowerBound( EventLatencyHistogram::getBucketIndex( nanos ) );
+		CHECK( bound <= nanos );
+		CHECK( bound * 4 > nanos * 3 );
+	}
+}
+
+EVENT_TEST( PercentilesFollowTheRecordedValues )
+{
+	EventMetrics metrics;
+	for( int i = 0; i < 90; ++i )
+		metrics.recordListener( kTypeA, 1, 1000 );
+	for( int i = 0; i < 10; ++i )
+		metrics.recordListener( kTypeA, 1, 100000 );
+
+	const auto &latency = metrics.snapshot().mListeners.at( 0 ).mLatency;
+	CHECK_EQ( latency.mCount, 100u );
+	CHECK_EQ( latency.mMaxNanos, 100000u );
+	CHECK_EQ( latency.getMeanNanos(), 10900.0 );
+	for( double percentile : { 0.0, 50.0, 89.0 } ) {
+		auto nanos = latency.getPercentileNanos( percentile );
+		CHECK( nanos <= 1000 && nanos * 4 > 1000 * 3 );
+	}
+	for( double percentile : { 91.0, 99.0, 100.0 } ) {
+		auto nanos = latency.getPercentileNanos( percentile );
+		CHECK( nanos <= 100000 && nanos * 4 > 100000 * 3 );
+	}
+	CHECK_EQ( EventLatencyHistogram().getPercentileNanos( 50.0 ), 0u );
+}
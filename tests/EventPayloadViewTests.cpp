@@ -0,0 +1,121 @@
+//
+//  EventPayloadViewTests.cpp
+//  Cinder-EventManager
+//
+//
+
+#include <cstring>
+
+#include "EventPayloadView.h"
+#include "TestSupport.h"
+
+namespace {
+
+//! A buffer holding the bytes 0, 1, 2, ... \a size - 1.
+std::shared_ptr<const EventBuffer> makeBuffer( size_t size )
+{
+	auto buffer = std::make_shared<EventBuffer>( size );
+	auto data = static_cast<uint8_t*>( buffer->getData() );
+	for( size_t i = 0; i < size; ++i )
+		data[i] = static_cast<uint8_t>( i );
+	return buffer;
+}
+
+} // anonymous namespace
+
+EVENT_TEST( SubViewsAreClampedToTheView )
+{
+	EventPayloadView view( makeBuffer( 16 ) );
+	CHECK_EQ( view.getSize(), 16u );
+
+	auto middle = view.subView( 4, 8 );
+	CHECK_EQ( middle.getSize(), 8u );
+	CHECK_EQ( middle.getData()[0], 4 );
+	CHECK( middle.getOwner() == view.getOwner() );
+
+	CHECK_EQ( view.subView( 12, 8 ).getSize(), 4u );
+	CHECK( view.subView( 16, 1 ).empty() );
+	CHECK( view.subView( 40, 1 ).empty() );
+	CHECK_EQ( middle.subView( 6, 100 ).getData()[0], 10 );
+	CHECK_EQ( middle.subView( 6, 100 ).getSize(), 2u );
+}
+
+EVENT_TEST( ReadsStayInsideTheView )
+{
+	EventPayloadView view = EventPayloadView( makeBuffer( 16 ) ).subView( 4, 8 );
+	uint32_t value = 0;
+	CHECK( view.read( 0, &value ) );
+	uint32_t expected;
+	const uint8_t bytes[] = { 4, 5, 6, 7 };
+	std::memcpy( &expected, bytes, sizeof( expected ) );
+	CHECK_EQ( value, expected );
+
+	CHECK( view.read( 4, &value ) );
+	value = 42;
+	CHECK( ! view.read( 5, &value ) );
+	CHECK( ! view.read( 8, &value ) );
+	CHECK( ! view.read( size_t( -1 ), &value ) );
+	CHECK_EQ( value, 42u );
+
+	uint64_t wide = 0;
+	CHECK( view.read( 0, &wide ) );
+	CHECK( ! EventPayloadView().read( 0, &wide ) );
+}
+
+EVENT_TEST( ViewsKeepTheirBufferAlive )
+{
+	auto buffer = makeBuffer( 8 );
+	std::weak_ptr<const EventBuffer> observer = buffer;
+	EventPayloadView view = EventPayloadView( buffer ).subView( 2, 2 );
+	buffer.reset();
+	CHECK( ! observer.expired() );
+	CHECK_EQ( view.getData()[1], 3 );
+	view = EventPayloadView();
+	CHECK( observer.expired() );
+}
+
+EVENT_TEST( LazyFieldsDecodeOnce )
+{
+	auto buffer = std::make_shared<EventBuffer>( sizeof( double ) * 2 );
+	auto data = static_cast<double*>( buffer->getData() );
+	data[0] = 1.5;
+	data[1] = 2.5;
+	EventPayloadView view( buffer );
+
+	LazyPayloadField<double> field( sizeof( double ) );
+	CHECK( ! field.isDecoded() );
+	CHECK_EQ( field.get( view ), 2.5 );
+	CHECK( field.isDecoded() );
+
+	// Later reads come from the cache, not the payload.
+	data[1] = 9.0;
+	CHECK_EQ( field.get( view ), 2.5 );
+	field.set( 3.5 );
+	CHECK_EQ( field.get( view ), 3.5 );
+}
+
+EVENT_TEST( OutOfRangeLazyFieldsAreValueInitialized )
+{
+	EventPayloadView view( makeBuffer( 4 ) );
+	LazyPayloadField<uint64_t> field( 2 );
+	CHECK_EQ( field.get( view ), 0u );
+	CHECK( field.isDecoded() );
+}
+
+EVENT_TEST( MovedFromBuffersAreEmpty )
+{
+	EventBuffer owned( 8 );
+	auto data = owned.getData();
+	EventBuffer moved( std::move( owned ) );
+	CHECK( moved.getData() == data );
+	CHECK_EQ( moved.getSize(), 8u );
+	CHECK( ! owned.getData() );
+	CHECK_EQ( owned.getSize(), 0u );
+
+	uint8_t bytes[4] = {};
+	EventBuffer wrapped( bytes, sizeof( bytes ) );
+	wrapped = std::move( moved );
+	CHECK( wrapped.getData() == data );
+	CHECK( ! moved.getData() );
+	CHECK_EQ( moved.getSize(), 0u );
+}
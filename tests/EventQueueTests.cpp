@@ -0,0 +1,206 @@
+//
+//  EventQueueTests.cpp
+//  Cinder-EventManager
+//
+//
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "EventManager.h"
+#include "TestEvents.h"
+#include "TestSupport.h"
+
+namespace {
+
+using Policy = EventManager::OverflowPolicy;
+
+const EventType kTypeA = 5001;
+const EventType kTypeB = 5002;
+
+//! A manager with listeners recording the values of kTypeA and kTypeB events.
+struct QueueFixture {
+	QueueFixture()
+	: mManager( EventManager::create( "Test", false ) )
+	{
+		for( auto type : { kTypeA, kTypeB } )
+			mManager->addListener( [this]( EventDataRef event ) { mValues.push_back( std::static_pointer_cast<TestEvent>( event )->getValue() ); }, type );
+	}
+
+	//! Dispatches everything queued and returns the values seen.
+	std::vector<int> update()
+	{
+		mValues.clear();
+		mManager->update();
+		return mValues;
+	}
+
+	EventManagerRef		mManager;
+	std::vector<int>	mValues;
+};
+
+//! Queues \a events from a thread other than the manager's owner and
+//! returns how many queueEvent() accepted.
+int queueFromOtherThread( const EventManagerRef &manager, EventType type, int numEvents )
+{
+	int numAccepted = 0;
+	std::thread producer( [&] {
+		for( int i = 0; i < numEvents; ++i )
+			numAccepted += manager->queueEvent( makeEvent( type, i ) );
+	} );
+	producer.join();
+	return numAccepted;
+}
+
+} // anonymous namespace
+
+EVENT_TEST( RejectRefusesEventsOverCapacity )
+{
+	QueueFixture fixture;
+	fixture.mManager->setQueueCapacity( 2, Policy::REJECT );
+	CHECK( fixture.mManager->queueEvent( makeEvent( kTypeA, 1 ) ) );
+	CHECK( fixture.mManager->queueEvent( makeEvent( kTypeA, 2 ) ) );
+	CHECK( ! fixture.mManager->queueEvent( makeEvent( kTypeA, 3 ) ) );
+	CHECK_EQ( fixture.update(), ( std::vector<int>{ 1, 2 } ) );
+	CHECK_EQ( fixture.mManager->getQueueStats().mNumRejected, 1u );
+}
+
+EVENT_TEST( DropNewestDiscardsTheNewEvent )
+{
+	QueueFixture fixture;
+	fixture.mManager->setQueueCapacity( 2, Policy::DROP_NEWEST );
+	for( int i = 1; i <= 3; ++i )
+		CHECK( fixture.mManager->queueEvent( makeEvent( kTypeA, i ) ) );
+	CHECK_EQ( fixture.update(), ( std::vector<int>{ 1, 2 } ) );
+	CHECK_EQ( fixture.mManager->getQueueStats().mNumDropped, 1u );
+}
+
+EVENT_TEST( DropOldestDiscardsTheOldestEvent )
+{
+	QueueFixture fixture;
+	fixture.mManager->setQueueCapacity( 2, Policy::DROP_OLDEST );
+	for( int i = 1; i <= 4; ++i )
+		CHECK( fixture.mManager->queueEvent( makeEvent( kTypeA, i ) ) );
+	CHECK_EQ( fixture.update(), ( std::vector<int>{ 3, 4 } ) );
+	CHECK_EQ( fixture.mManager->getQueueStats().mNumDropped, 2u );
+}
+
+EVENT_TEST( CoalesceReplacesTheSameTypeAndKey )
+{
+	QueueFixture fixture;
+	fixture.mManager->setQueueCapacity( 2, Policy::COALESCE );
+	fixture.mManager->queueEvent( makeEvent( kTypeA, 1, 5 ) );
+	fixture.mManager->queueEvent( makeEvent( kTypeB, 2 ) );
+	fixture.mManager->queueEvent( makeEvent( kTypeA, 3, 5 ) );
+	// Nothing shares type and key with the next one, so the oldest goes.
+	fixture.mManager->queueEvent( makeEvent( kTypeA, 4, 6 ) );
+	CHECK_EQ( fixture.update(), ( std::vector<int>{ 2, 4 } ) );
+	auto stats = fixture.mManager->getQueueStats();
+	CHECK_EQ( stats.mNumCoalesced, 1u );
+	CHECK_EQ( stats.mNumDropped, 1u );
+}
+
+EVENT_TEST( BlockProducerRejectsOnTheOwningThread )
+{
+	QueueFixture fixture;
+	fixture.mManager->setQueueCapacity( 1, Policy::BLOCK_PRODUCER );
+	CHECK( fixture.mManager->queueEvent( makeEvent( kTypeA ) ) );
+	CHECK( ! fixture.mManager->queueEvent( makeEvent( kTypeA ) ) );
+	CHECK_EQ( fixture.mManager->getQueueStats().mNumRejected, 1u );
+}
+
+EVENT_TEST( TypeCapacityIsCheckedFirstAndResetByUpdate )
+{
+	QueueFixture fixture;
+	fixture.mManager->setQueueCapacity( kTypeA, 1, Policy::COALESCE );
+	for( int i = 1; i <= 3; ++i ) {
+		fixture.mManager->queueEvent( makeEvent( kTypeA, i ) );
+		fixture.mManager->queueEvent( makeEvent( kTypeB, 100 + i ) );
+	}
+	CHECK_EQ( fixture.update(), ( std::vector<int>{ 3, 101, 102, 103 } ) );
+
+	CHECK( fixture.mManager->queueEvent( makeEvent( kTypeA, 7 ) ) );
+	CHECK( fixture.mManager->abortEvent( kTypeA ) );
+	CHECK( fixture.mManager->queueEvent( makeEvent( kTypeA, 8 ) ) );
+	CHECK_EQ( fixture.update(), std::vector<int>{ 8 } );
+}
+
+EVENT_TEST( MailboxAndQueueShareOneCapacity )
+{
+	QueueFixture fixture;
+	fixture.mManager->setQueueCapacity( 4, Policy::REJECT );
+	CHECK_EQ( queueFromOtherThread( fixture.mManager, kTypeA, 3 ), 3 );
+	CHECK( fixture.mManager->queueEvent( makeEvent( kTypeB, 10 ) ) );
+	CHECK( ! fixture.mManager->queueEvent( makeEvent( kTypeB, 11 ) ) );
+	CHECK_EQ( queueFromOtherThread( fixture.mManager, kTypeA, 1 ), 0 );
+	// Everything accepted is dispatched; nothing is turned away later.
+	CHECK_EQ( fixture.update().size(), 4u );
+	CHECK_EQ( fixture.mManager->getQueueStats().mNumRejected, 2u );
+	CHECK_EQ( queueFromOtherThread( fixture.mManager, kTypeA, 4 ), 4 );
+}
+
+EVENT_TEST( DropOldestDropsTheNewEventWhenOnlyTheMailboxHoldsEvents )
+{
+	QueueFixture fixture;
+	fixture.mManager->setQueueCapacity( 2, Policy::DROP_OLDEST );
+	queueFromOtherThread( fixture.mManager, kTypeA, 2 );
+	CHECK( fixture.mManager->queueEvent( makeEvent( kTypeB, 10 ) ) );
+	CHECK_EQ( fixture.update(), ( std::vector<int>{ 0, 1 } ) );
+	CHECK_EQ( fixture.mManager->getQueueStats().mNumDropped, 1u );
+}
+
+EVENT_TEST( TypeRejectLetsAcceptedMailboxEventsThrough )
+{
+	QueueFixture fixture;
+	fixture.mManager->setQueueCapacity( kTypeA, 1, Policy::REJECT );
+	CHECK_EQ( queueFromOtherThread( fixture.mManager, kTypeA, 3 ), 3 );
+	CHECK_EQ( fixture.update(), ( std::vector<int>{ 0, 1, 2 } ) );
+	CHECK_EQ( fixture.mManager->getQueueStats().mNumRejected, 0u );
+}
+
+EVENT_TEST( DiscardedMailboxEventsFreeTheirShareOfTheCapacity )
+{
+	QueueFixture fixture;
+	fixture.mManager->setQueueCapacity( 3, Policy::REJECT );
+	fixture.mManager->setQueueCapacity( kTypeA, 1, Policy::DROP_NEWEST );
+	CHECK_EQ( queueFromOtherThread( fixture.mManager, kTypeA, 3 ), 3 );
+	CHECK_EQ( fixture.update(), std::vector<int>{ 0 } );
+	CHECK_EQ( fixture.mManager->getQueueStats().mNumDropped, 2u );
+	// As are events nobody listens to.
+	const EventType kUnheardType = 5003;
+	CHECK_EQ( queueFromOtherThread( fixture.mManager, kUnheardType, 3 ), 3 );
+	fixture.update();
+
+	for( int i = 0; i < 3; ++i )
+		CHECK( fixture.mManager->queueEvent( makeEvent( kTypeB, i ) ) );
+	CHECK( ! fixture.mManager->queueEvent( makeEvent( kTypeB, 3 ) ) );
+}
+
+EVENT_TEST( BlockedProducersDeliverEveryEvent )
+{
+	QueueFixture fixture;
+	fixture.mManager->setQueueCapacity( 8, Policy::BLOCK_PRODUCER );
+	const int kNumProducers = 3, kNumEvents = 1000;
+	std::atomic<int> numDone( 0 ), numRefused( 0 );
+	std::vector<std::thread> producers;
+	for( int p = 0; p < kNumProducers; ++p ) {
+		producers.emplace_back( [&] {
+			for( int i = 0; i < kNumEvents; ++i )
+				numRefused += ! fixture.mManager->queueEvent( makeEvent( kTypeA, i ) );
+			++numDone;
+		} );
+	}
+	size_t numSeen = 0;
+	while( numDone < kNumProducers ) {
+		fixture.mManager->waitAndUpdate( 5 );
+		numSeen += fixture.mValues.size();
+		fixture.mValues.clear();
+	}
+	for( auto &producer : producers )
+		producer.join();
+	numSeen += fixture.update().size();
+
+	CHECK_EQ( numRefused.load(), 0 );
+	CHECK_EQ( numSeen, size_t( kNumProducers * kNumEvents ) );
+}
@@ -0,0 +1,186 @@
+//
+//  EventRequestTests.cpp
+//  Cinder-EventManager
+//
+//
+
+#include <thread>
+
+#include "EventManager.h"
+#include "TestSupport.h"
+
+namespace {
+
+//! request() needs request and reply classes with a static TYPE.
+template<EventType Type>
+class ValueEvent : public EventData {
+public:
+	static const EventType TYPE = Type;
+
+	explicit ValueEvent( int value = 0 ) : mValue( value ) {}
+
+	EventDataRef copy() override { return std::make_shared<ValueEvent>( *this ); }
+	const char* getName() const override { return "ValueEvent"; }
+	EventType getEventType() const override { return TYPE; }
+	void serialize( EventBuffer &/*streamOut*/ ) override {}
+	void deSerialize( const EventBuffer &/*streamIn*/ ) override {}
+
+	int mValue;
+};
+
+template<EventType Type>
+const EventType ValueEvent<Type>::TYPE;
+
+using Query = ValueEvent<4001>;
+using Reply = ValueEvent<4002>;
+using Unheard = ValueEvent<4003>;
+
+double sNow = 0.0;
+
+EventManagerRef makeManager()
+{
+	auto manager = EventManager::create( "Test", false );
+	sNow = 0.0;
+	manager->setClock( [] { return sNow; } );
+	return manager;
+}
+
+//! Answers every query with twice its value, queued for the next update().
+void addDoubler( const EventManagerRef &manager )
+{
+	EventManager *raw = manager.get();
+	manager->addListener( [raw]( EventDataRef event ) {
+		auto query = std::static_pointer_cast<Query>( event );
+		auto reply = std::make_shared<Reply>( query->mValue * 2 );
+		reply->replyTo( *query );
+		raw->queueEvent( reply );
+	}, Query::TYPE );
+}
+
+//! Hears every query and answers none, leaving replies to the test.
+void addSilentResponder( const EventManagerRef &manager )
+{
+	manager->addListener( []( EventDataRef ) {}, Query::TYPE );
+}
+
+} // anonymous namespace
+
+EVENT_TEST( RequestIsResolvedByItsReply )
+{
+	auto manager = makeManager();
+	addDoubler( manager );
+	auto future = manager->request<Query, Reply>( std::make_shared<Query>( 21 ), 1.0 );
+	CHECK( future.valid() );
+	CHECK( ! future.isReady() );
+
+	manager->update();
+	CHECK( ! future.isReady() );
+	manager->update();
+	CHECK( future.isReady() );
+	auto reply = future.get();
+	CHECK( reply && reply->mValue == 42 );
+	CHECK( ! future.valid() );
+	CHECK_EQ( manager->getNumPendingRequests(), 0u );
+}
+
+EVENT_TEST( LateRepliesDontResolveTimedOutRequests )
+{
+	auto manager = makeManager();
+	addSilentResponder( manager );
+	auto query = std::make_shared<Query>();
+	auto future = manager->request<Query, Reply>( query, 0.5 );
+	sNow = 1.0;
+	CHECK( future.isTimedOut() );
+
+	auto late = std::make_shared<Reply>();
+	late->replyTo( *query );
+	manager->triggerEvent( late );
+	CHECK( future.isTimedOut() );
+	CHECK( ! future.get() );
+}
+
+EVENT_TEST( DestroyedFuturesCloseTheirRequest )
+{
+	auto manager = makeManager();
+	addSilentResponder( manager );
+	uint64_t staleId;
+	{
+		auto future = manager->request<Query, Reply>( std::make_shared<Query>() );
+		staleId = future.getCorrelationId();
+		CHECK_EQ( manager->getNumPendingRequests(), 1u );
+	}
+	CHECK_EQ( manager->getNumPendingRequests(), 0u );
+
+	// The slot is reused under a new id, which the stale reply doesn't match.
+	auto future = manager->request<Query, Reply>( std::make_shared<Query>() );
+	CHECK( future.getCorrelationId() != staleId );
+	auto stale = std::make_shared<Reply>();
+	stale->setCorrelationId( staleId );
+	manager->triggerEvent( stale );
+	CHECK( ! future.isReady() );
+	// Nor is it queued, with nobody listening for replies.
+	CHECK( ! manager->queueEvent( stale ) );
+}
+
+EVENT_TEST( RequestsNobodyListensForAreInvalid )
+{
+	auto manager = makeManager();
+	auto query = std::make_shared<Query>();
+	auto future = manager->request<Query, Reply>( query );
+	CHECK( ! future.valid() );
+	CHECK( future.getStatus() == EventFuture<Reply>::Status::INVALID );
+	CHECK_EQ( query->getCorrelationId(), 0u );
+	CHECK_EQ( manager->getNumPendingRequests(), 0u );
+}
+
+EVENT_TEST( OnlyAwaitedRepliesSkipTheListenerCheck )
+{
+	auto manager = makeManager();
+	addSilentResponder( manager );
+	auto future = manager->request<Query, Reply>( std::make_shared<Query>() );
+
+	// An event of another type carrying the id isn't the reply.
+	auto wrongType = std::make_shared<Unheard>();
+	wrongType->setCorrelationId( future.getCorrelationId() );
+	CHECK( ! manager->queueEvent( wrongType ) );
+
+	auto reply = std::make_shared<Reply>( 3 );
+	reply->setCorrelationId( future.getCorrelationId() );
+	CHECK( manager->queueEvent( reply ) );
+	manager->update();
+	CHECK( future.isReady() );
+}
+
+EVENT_TEST( RepliesFromOtherThreadsResolveRequests )
+{
+	auto manager = makeManager();
+	addSilentResponder( manager );
+	auto future = manager->request<Query, Reply>( std::make_shared<Query>() );
+	auto id = future.getCorrelationId();
+	std::thread responder( [&manager, id] {
+		auto reply = std::make_shared<Reply>( 7 );
+		reply->setCorrelationId( id );
+		manager->queueEvent( reply );
+	} );
+	responder.join();
+
+	manager->update();
+	auto reply = future.get();
+	CHECK( reply && reply->mValue == 7 );
+}
+
+EVENT_TEST( UnqueueableRequestsAreClosed )
+{
+	auto manager = makeManager();
+	addDoubler( manager );
+	manager->setQueueCapacity( 1 );
+	auto first = manager->request<Query, Reply>( std::make_shared<Query>() );
+	CHECK( first.valid() );
+
+	auto query = std::make_shared<Query>();
+	auto rejected = manager->request<Query, Reply>( query );
+	CHECK( ! rejected.valid() );
+	CHECK( rejected.getStatus() == EventFuture<Reply>::Status::INVALID );
+	CHECK_EQ( query->getCorrelationId(), 0u );
+	CHECK_EQ( manager->getNumPendingRequests(), 1u );
+}
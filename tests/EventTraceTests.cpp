@@ -0,0 +1,64 @@
+//
+//  EventTraceTests.cpp
+//  Cinder-EventManager
+//
+//
+
+#include <atomic>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "EventTrace.h"
+#include "TestSupport.h"
+
+// Each span is recorded with ts == dur == arg, so a span torn by the recording
+// thread overwriting it during export shows up as a mismatch.
+EVENT_TEST( ExportSkipsSpansOverwrittenWhileCopying )
+{
+	EventTrace::clear();
+	std::atomic<bool> done( false );
+	std::atomic<uint64_t> numRecorded( 0 );
+	std::thread recorder( [&] {
+		for( uint64_t arg = 1; ! done; ++arg ) {
+			EventTrace::record( "span", EventTrace::EVENT, arg, arg * 1000, arg * 2000 );
+			numRecorded.store( arg, std::memory_order_relaxed );
+		}
+	} );
+	// Export only once the ring has wrapped, so every export races overwrites.
+	while( numRecorded.load( std::memory_order_relaxed ) < 2 * EVENT_MANAGER_TRACE_BUFFER_SIZE )
+		std::this_thread::yield();
+
+	size_t numSpans = 0, numTorn = 0;
+	for( int pass = 0; pass < 20; ++pass ) {
+		std::ostringstream stream;
+		EventTrace::writeChromeTrace( stream );
+		std::istringstream lines( stream.str() );
+		std::string line;
+		while( std::getline( lines, line ) ) {
+			unsigned long long ts, tsFraction, dur, durFraction, arg;
+			auto found = line.find( "\"ts\":" );
+			if( found == std::string::npos )
+				continue;
+			if( sscanf( line.c_str() + found, "\"ts\":%llu.%llu,\"dur\":%llu.%llu,\"args\":{\"arg\":%llu}", &ts, &tsFraction, &dur, &durFraction, &arg ) != 5
+			   || ts != arg || dur != arg || tsFraction || durFraction )
+				++numTorn;
+			++numSpans;
+		}
+	}
+	done = true;
+	recorder.join();
+
+	CHECK( numSpans > 0 );
+	CHECK_EQ( numTorn, 0u );
+}
+
+EVENT_TEST( ClearDropsBufferedSpans )
+{
+	EventTrace::record( "span", EventTrace::EVENT, 1, 1000, 2000 );
+	EventTrace::clear();
+	std::ostringstream stream;
+	EventTrace::writeChromeTrace( stream );
+	CHECK_EQ( stream.str().find( "\"ph\":\"X\"" ), std::string::npos );
+}
@@ -0,0 +1,135 @@
+//
+//  EventWaitTests.cpp
+//  Cinder-EventManager
+//
+//
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#if defined( __linux__ )
+	#include <poll.h>
+#endif
+
+#include "EventManager.h"
+#include "TestEvents.h"
+#include "TestSupport.h"
+
+namespace {
+
+const EventType kType = 6001;
+const auto kDelay = std::chrono::milliseconds( 20 );
+
+void addRecorder( EventManager &manager, std::vector<int> &values )
+{
+	manager.addListener( [&values]( EventDataRef event ) {
+		values.push_back( std::static_pointer_cast<TestEvent>( event )->getValue() );
+	}, kType );
+}
+
+void checkWaitsForOtherThreads( EventManager::WaitMode mode )
+{
+	auto manager = EventManager::create( "Test", false );
+	manager->setWaitMode( mode );
+	std::vector<int> values;
+	addRecorder( *manager, values );
+
+	std::thread producer( [&] {
+		std::this_thread::sleep_for( kDelay );
+		manager->queueEvent( makeEvent( kType, 1 ) );
+	} );
+	CHECK( manager->waitAndUpdate() );
+	producer.join();
+	CHECK_EQ( values, std::vector<int>{ 1 } );
+}
+
+void checkTimesOut( EventManager::WaitMode mode )
+{
+	auto manager = EventManager::create( "Test", false );
+	manager->setWaitMode( mode );
+	std::vector<int> values;
+	addRecorder( *manager, values );
+
+	auto start = std::chrono::steady_clock::now();
+	CHECK( ! manager->waitAndUpdate( 10 ) );
+	CHECK( std::chrono::steady_clock::now() - start >= std::chrono::milliseconds( 10 ) );
+
+	// Events queued on the owning thread don't wait at all.
+	manager->queueEvent( makeEvent( kType, 2 ) );
+	CHECK( manager->waitAndUpdate( 0 ) );
+	CHECK_EQ( values, std::vector<int>{ 2 } );
+}
+
+void checkWakeEndsTheWait( EventManager::WaitMode mode )
+{
+	auto manager = EventManager::create( "Test", false );
+	manager->setWaitMode( mode );
+
+	std::thread waker( [&] {
+		std::this_thread::sleep_for( kDelay );
+		manager->wake();
+	} );
+	CHECK( ! manager->waitAndUpdate() );
+	waker.join();
+
+	// A wake() with nobody waiting ends the next wait.
+	manager->wake();
+	CHECK( ! manager->waitAndUpdate() );
+}
+
+} // anonymous namespace
+
+EVENT_TEST( BlockingWaitHearsOtherThreads )
+{
+	checkWaitsForOtherThreads( EventManager::WaitMode::BLOCK );
+}
+
+EVENT_TEST( PollingWaitHearsOtherThreads )
+{
+	checkWaitsForOtherThreads( EventManager::WaitMode::POLL );
+}
+
+EVENT_TEST( BlockingWaitTimesOut )
+{
+	checkTimesOut( EventManager::WaitMode::BLOCK );
+}
+
+EVENT_TEST( PollingWaitTimesOut )
+{
+	checkTimesOut( EventManager::WaitMode::POLL );
+}
+
+EVENT_TEST( WakeEndsABlockingWait )
+{
+	checkWakeEndsTheWait( EventManager::WaitMode::BLOCK );
+}
+
+EVENT_TEST( WakeEndsAPollingWait )
+{
+	checkWakeEndsTheWait( EventManager::WaitMode::POLL );
+}
+
+#if defined( __linux__ )
+EVENT_TEST( EventFdBecomesReadableForOtherThreads )
+{
+	auto manager = EventManager::create( "Test", false );
+	std::vector<int> values;
+	addRecorder( *manager, values );
+	int fd = manager->getEventFd();
+	CHECK( fd >= 0 );
+	CHECK_EQ( manager->getEventFd(), fd );
+
+	pollfd watch = { fd, POLLIN, 0 };
+	CHECK_EQ( ::poll( &watch, 1, 0 ), 0 );
+
+	std::thread producer( [&] { manager->queueEvent( makeEvent( kType, 1 ) ); } );
+	CHECK_EQ( ::poll( &watch, 1, 5000 ), 1 );
+	producer.join();
+	manager->update();
+	CHECK_EQ( values, std::vector<int>{ 1 } );
+
+	watch.revents = 0;
+	CHECK_EQ( ::poll( &watch, 1, 0 ), 0 );
+}
+#endif
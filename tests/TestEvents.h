@@ -0,0 +1,47 @@
+//
+//  TestEvents.h
+//  Cinder-EventManager
+//
+//
+
+#pragma once
+
+#include <memory>
+
+#include "BaseEventData.h"
+
+//! An event whose type and key are chosen per instance, so one class covers
+//! every type a test needs. Carries a value to tell events apart and two
+//! filter fields.
+class TestEvent : public EventData {
+public:
+	enum FilterField : uint32_t { FIELD_X = 1, FIELD_Y };
+
+	explicit TestEvent( EventType type, int value = 0, EventKey key = NO_EVENT_KEY )
+	: mType( type ), mKey( key ), mValue( value ), mX( 0.0 ), mY( 0.0 ) {}
+	TestEvent( EventType type, double x, double y ) : mType( type ), mKey( NO_EVENT_KEY ), mValue( 0 ), mX( x ), mY( y ) {}
+
+	double getFilterValue( uint32_t field ) const override
+	{
+		return field == FIELD_X ? mX : field == FIELD_Y ? mY : EventData::getFilterValue( field );
+	}
+	EventKey getEventKey() const override { return mKey; }
+	EventDataRef copy() override { return std::make_shared<TestEvent>( *this ); }
+	const char* getName() const override { return "TestEvent"; }
+	EventType getEventType() const override { return mType; }
+	void serialize( EventBuffer &/*streamOut*/ ) override {}
+	void deSerialize( const EventBuffer &/*streamIn*/ ) override {}
+
+	int getValue() const { return mValue; }
+
+private:
+	EventType	mType;
+	EventKey	mKey;
+	int			mValue;
+	double		mX, mY;
+};
+
+inline std::shared_ptr<TestEvent> makeEvent( EventType type, int value = 0, EventKey key = NO_EVENT_KEY )
+{
+	return std::make_shared<TestEvent>( type, value, key );
+}
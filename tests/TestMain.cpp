@@ -0,0 +1,40 @@
+//
+//  TestMain.cpp
+//  Cinder-EventManager
+//
+//
+
+#include "TestSupport.h"
+
+namespace {
+
+size_t sNumFailures = 0;
+
+} // anonymous namespace
+
+std::vector<TestCase>& getTestCases()
+{
+	static std::vector<TestCase> sTestCases;
+	return sTestCases;
+}
+
+void failTest( const char *file, int line, const std::string &message )
+{
+	std::cerr << file << ":" << line << ": failed " << message << std::endl;
+	++sNumFailures;
+}
+
+int main()
+{
+	size_t numFailedTests = 0;
+	for( const auto &test : getTestCases() ) {
+		auto failuresBefore = sNumFailures;
+		test.mRun();
+		bool passed = sNumFailures == failuresBefore;
+		std::cout << ( passed ? "[ pass ] " : "[ FAIL ] " ) << test.mName << std::endl;
+		if( ! passed )
+			++numFailedTests;
+	}
+	std::cout << getTestCases().size() - numFailedTests << " of " << getTestCases().size() << " tests passed" << std::endl;
+	return numFailedTests == 0 ? 0 : 1;
+}
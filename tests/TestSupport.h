@@ -0,0 +1,46 @@
+//
+//  TestSupport.h
+//  Cinder-EventManager
+//
+//
+
+#pragma once
+
+// Minimal self-registering checks, so the suite builds wherever the library
+// does. A failed CHECK reports its location and fails the test, but lets the
+// test carry on; TestMain.cpp runs every registered test and returns non-zero
+// if any failed.
+
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct TestCase {
+	std::string				mName;
+	std::function<void()>	mRun;
+};
+
+std::vector<TestCase>&	getTestCases();
+//! Records a failure of the running test.
+void					failTest( const char *file, int line, const std::string &message );
+
+struct TestRegistrar {
+	TestRegistrar( const char *name, std::function<void()> run ) { getTestCases().push_back( { name, std::move( run ) } ); }
+};
+
+#define EVENT_TEST( name ) \
+	static void name(); \
+	static TestRegistrar name##Registrar( #name, &name ); \
+	static void name()
+
+#define CHECK( expr ) \
+	do { if( ! ( expr ) ) failTest( __FILE__, __LINE__, "CHECK( " #expr " )" ); } while( 0 )
+
+#define CHECK_EQ( actual, expected ) \
+	do { \
+		const auto &checkActual = ( actual ); \
+		const auto &checkExpected = ( expected ); \
+		if( ! ( checkActual == checkExpected ) ) \
+			failTest( __FILE__, __LINE__, "CHECK_EQ( " #actual ", " #expected " )" ); \
+	} while( 0 )